@@ -0,0 +1,97 @@
+// In-process microbenchmarks for DataStore and PubSub, no network involved
+//
+// Build: g++ -O2 -std=c++17 micro-benchmark.cpp src/DataStore.cpp src/LazyFree.cpp src/PubSub.cpp -o micro-benchmark -lpthread
+// Usage: micro-benchmark [iterations] [--max-ns N]
+//   --max-ns N   exit with status 1 if any case averages more than N ns/op (for CI regression checks)
+
+#include "src/DataStore.h"
+#include "src/PubSub.h"
+#include "src/Histogram.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cstdlib>
+#include <cstdio>
+
+static bool failed = false;
+static double maxNsPerOp = 0;
+
+// Times each call individually so the report has percentiles, not just an average
+static void bench(const std::string& name, long iterations, const std::function<void(long)>& op) {
+    LatencyHistogram histogram;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        op(i);
+        auto t1 = std::chrono::steady_clock::now();
+        histogram.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double nsPerOp = seconds * 1e9 / iterations;
+
+    printf("%-24s %10.0f ops/sec %8.1f ns/op   p50=%llu p99=%llu p999=%llu ns\n",
+           name.c_str(), iterations / seconds, nsPerOp,
+           (unsigned long long)histogram.valueAtPercentile(50),
+           (unsigned long long)histogram.valueAtPercentile(99),
+           (unsigned long long)histogram.valueAtPercentile(99.9));
+
+    if (maxNsPerOp > 0 && nsPerOp > maxNsPerOp) {
+        printf("  ^ over budget of %.0f ns/op\n", maxNsPerOp);
+        failed = true;
+    }
+}
+
+static std::string keyFor(long i, long keyspace) {
+    char key[32];
+    snprintf(key, sizeof(key), "key:%012ld", i % keyspace);
+    return key;
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = 200000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max-ns" && i + 1 < argc) maxNsPerOp = std::atof(argv[++i]);
+        else iterations = std::max(1L, std::atol(argv[i]));
+    }
+    const long keyspace = 10000;
+
+    std::cout << "=== DataStore ===" << std::endl;
+    {
+        DataStore store;
+        bench("SET", iterations, [&](long i) { store.set(keyFor(i, keyspace), "value"); });
+        bench("GET (hit)", iterations, [&](long i) { store.get(keyFor(i, keyspace)); });
+        bench("GET (miss)", iterations, [&](long i) { store.get("missing:" + std::to_string(i)); });
+        bench("INCR", iterations, [&](long) { store.incr("counter"); });
+        bench("HSET", iterations, [&](long i) { store.hset("hash", keyFor(i, keyspace), "value"); });
+        bench("HGET", iterations, [&](long i) { store.hget("hash", keyFor(i, keyspace)); });
+        bench("RPUSH", iterations, [&](long) { store.rpush("list", "value"); });
+        bench("RPOP", iterations, [&](long) { store.rpop("list"); });
+        bench("SADD", iterations, [&](long i) { store.sadd("set", keyFor(i, keyspace)); });
+        bench("EXISTS", iterations, [&](long i) { store.exists(keyFor(i, keyspace)); });
+    }
+
+    std::cout << "=== PubSub ===" << std::endl;
+    {
+        PubSub pubSub;
+        bench("PUBLISH (0 subs)", iterations, [&](long) { pubSub.publish("nobody", "message"); });
+
+        std::vector<int> subscribers;
+        for (int i = 0; i < 10; ++i) {
+            int id = pubSub.registerClient();
+            pubSub.subscribe(id, "news");
+            subscribers.push_back(id);
+        }
+        bench("PUBLISH (10 subs)", iterations, [&](long i) {
+            pubSub.publish("news", "message");
+            // Drain now and then so queues stay bounded, as connected clients would
+            if (i % 64 == 63) {
+                for (int id : subscribers) pubSub.getMessages(id);
+            }
+        });
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,242 @@
+// Load generator for the Redis-like server (redis-benchmark equivalent)
+//
+// Build: g++ -O2 -std=c++17 redis-benchmark.cpp src/Platform.cpp -o redis-benchmark -lpthread   (add -lws2_32 on Windows)
+// Usage: redis-benchmark [-h host] [-p port] [-c clients] [-n requests] [-P pipeline]
+//                        [-r keyspace] [-d bytes] [-t set,get,incr,lpush,publish] [-s subscribers]
+
+#include "src/Platform.h"
+#include "src/Histogram.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+
+struct BenchConfig {
+    std::string host = "127.0.0.1";
+    int port = 6379;
+    int clients = 50;
+    long requests = 100000;
+    int pipeline = 1;
+    long keyspace = 10000;
+    int dataSize = 3;
+    int subscribers = 0;
+    std::vector<std::string> tests = {"SET", "GET", "INCR", "LPUSH", "PUBLISH"};
+};
+
+static SOCKET openConnection(const BenchConfig& config) {
+    SOCKET sock = connectTo(config.host, config.port);
+    if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+
+    int noDelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+    // Skip the welcome banner
+    std::string pending, line;
+    if (!readLine(sock, pending, line)) {
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+static std::string buildCommand(const std::string& test, const BenchConfig& config, std::mt19937_64& rng, const std::string& value) {
+    char key[32];
+    snprintf(key, sizeof(key), "key:%012ld", config.keyspace > 0 ? (long)(rng() % config.keyspace) : 0L);
+
+    if (test == "SET") return std::string("SET ") + key + " " + value + "\n";
+    if (test == "GET") return std::string("GET ") + key + "\n";
+    if (test == "INCR") return std::string("INCR counter:") + (key + 4) + "\n";
+    if (test == "LPUSH") return "LPUSH mylist " + value + "\n";
+    if (test == "PUBLISH") return "PUBLISH bench:channel " + value + "\n";
+    return test + "\n";
+}
+
+// One client connection: send `pipeline` commands, wait for as many reply lines, repeat
+static void clientLoop(const BenchConfig& config, const std::string& test, long requests, unsigned seed,
+                       LatencyHistogram& histogram, std::atomic<long>& errors) {
+    SOCKET sock = openConnection(config);
+    if (sock == INVALID_SOCKET) {
+        errors += requests;
+        return;
+    }
+
+    std::mt19937_64 rng(seed);
+    std::string value(config.dataSize, 'x');
+    std::string batch, pending, line;
+    long done = 0;
+
+    while (done < requests) {
+        int depth = (int)std::min<long>(config.pipeline, requests - done);
+        batch.clear();
+        for (int i = 0; i < depth; ++i) batch += buildCommand(test, config, rng, value);
+
+        auto start = std::chrono::steady_clock::now();
+        if (!sendAll(sock, batch)) {
+            errors += requests - done;
+            break;
+        }
+        bool ok = true;
+        for (int i = 0; i < depth && ok; ++i) {
+            ok = readLine(sock, pending, line);
+            if (ok && line.compare(0, 5, "ERROR") == 0) errors++;
+        }
+        if (!ok) {
+            errors += requests - done;
+            break;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        // Every request in a pipelined batch sees the whole round trip, as in redis-benchmark
+        for (int i = 0; i < depth; ++i) histogram.record((uint64_t)elapsed.count());
+        done += depth;
+    }
+
+    sendAll(sock, "QUIT\n");
+    closesocket(sock);
+}
+
+// Subscriber for the PUBLISH fan-out test: counts delivered message lines
+static void subscriberLoop(const BenchConfig& config, std::atomic<bool>& ready, std::atomic<bool>& stop, std::atomic<long>& delivered) {
+    SOCKET sock = openConnection(config);
+    if (sock == INVALID_SOCKET) return;
+
+    std::string pending, line;
+    if (!sendAll(sock, "SUBSCRIBE bench:channel\n") || !readLine(sock, pending, line)) {
+        closesocket(sock);
+        return;
+    }
+    ready = true;
+
+    char buffer[16384];
+    while (!stop) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(sock, &readSet);
+        timeval timeout = {0, 100000};
+        if (select((int)sock + 1, &readSet, nullptr, nullptr, &timeout) <= 0) continue;
+
+        int n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        for (int i = 0; i < n; ++i) {
+            if (buffer[i] == '\n') delivered++;
+        }
+    }
+    closesocket(sock);
+}
+
+static void runTest(const BenchConfig& config, const std::string& test) {
+    std::atomic<bool> stopSubscribers(false);
+    std::atomic<long> delivered(0);
+    std::vector<std::thread> subscriberThreads;
+    std::vector<std::atomic<bool>> subscriberReady(test == "PUBLISH" ? config.subscribers : 0);
+    for (auto& ready : subscriberReady) {
+        ready = false;
+        subscriberThreads.emplace_back(subscriberLoop, std::cref(config), std::ref(ready), std::ref(stopSubscribers), std::ref(delivered));
+    }
+    for (auto& ready : subscriberReady) {
+        while (!ready) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<LatencyHistogram> histograms(config.clients);
+    std::vector<std::thread> threads;
+    std::atomic<long> errors(0);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < config.clients; ++i) {
+        long share = config.requests / config.clients + (i < config.requests % config.clients ? 1 : 0);
+        threads.emplace_back(clientLoop, std::cref(config), test, share, 1234u + i, std::ref(histograms[i]), std::ref(errors));
+    }
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    LatencyHistogram total;
+    for (const auto& histogram : histograms) total.merge(histogram);
+
+    std::cout << "====== " << test << " ======" << std::endl;
+    std::cout << "  " << total.count() << " requests completed in " << seconds << " seconds" << std::endl;
+    std::cout << "  " << config.clients << " parallel clients, pipeline " << config.pipeline
+              << ", " << config.dataSize << " bytes payload, keyspace " << config.keyspace << std::endl;
+    std::cout << "  throughput: " << (long)(total.count() / seconds) << " requests per second" << std::endl;
+    std::cout << "  latency (usec): min=" << total.min() << " p50=" << total.valueAtPercentile(50)
+              << " p99=" << total.valueAtPercentile(99) << " p999=" << total.valueAtPercentile(99.9)
+              << " max=" << total.max() << " mean=" << (long)total.mean() << std::endl;
+    if (errors) std::cout << "  errors: " << errors << std::endl;
+
+    if (!subscriberThreads.empty()) {
+        // Give in-flight messages a moment to arrive before counting
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        stopSubscribers = true;
+        for (auto& thread : subscriberThreads) thread.join();
+        std::cout << "  fan-out: " << config.subscribers << " subscribers received " << delivered
+                  << " of " << total.count() * config.subscribers << " messages" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+static void usage() {
+    std::cout << "Usage: redis-benchmark [-h host] [-p port] [-c clients] [-n requests] [-P pipeline]\n"
+              << "                       [-r keyspace] [-d bytes] [-t set,get,incr,lpush,publish] [-s subscribers]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help") {
+            usage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "-h") config.host = value;
+        else if (arg == "-p") config.port = std::atoi(value.c_str());
+        else if (arg == "-c") config.clients = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "-n") config.requests = std::max(1L, std::atol(value.c_str()));
+        else if (arg == "-P") config.pipeline = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "-r") config.keyspace = std::atol(value.c_str());
+        else if (arg == "-d") config.dataSize = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "-s") config.subscribers = std::atoi(value.c_str());
+        else if (arg == "-t") {
+            config.tests.clear();
+            std::stringstream ss(value);
+            std::string test;
+            while (std::getline(ss, test, ',')) {
+                for (char& c : test) c = (char)toupper((unsigned char)c);
+                config.tests.push_back(test);
+            }
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed" << std::endl;
+        return 1;
+    }
+
+    SOCKET probe = openConnection(config);
+    if (probe == INVALID_SOCKET) {
+        std::cerr << "Could not connect to " << config.host << ":" << config.port << std::endl;
+        WSACleanup();
+        return 1;
+    }
+    closesocket(probe);
+
+    for (const auto& test : config.tests) runTest(config, test);
+
+    WSACleanup();
+    return 0;
+}
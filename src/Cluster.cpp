@@ -0,0 +1,523 @@
+#include "Cluster.h"
+#include "Replication.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+static unsigned short crc16(const char* buf, size_t len) {
+    unsigned short crc = 0;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= (unsigned short)((unsigned char)buf[i] << 8);
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (unsigned short)((crc << 1) ^ 0x1021) : (unsigned short)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+int keyHashSlot(const std::string& key) {
+    // Only the part inside the first non-empty {...} is hashed, so related keys can share a slot
+    size_t open = key.find('{');
+    if (open != std::string::npos) {
+        size_t close = key.find('}', open + 1);
+        if (close != std::string::npos && close != open + 1) {
+            return crc16(key.data() + open + 1, close - open - 1) & (CLUSTER_SLOTS - 1);
+        }
+    }
+    return crc16(key.data(), key.size()) & (CLUSTER_SLOTS - 1);
+}
+
+// Parses "0-5460,5461,..." into [first, last] pairs
+static bool parseSlotRanges(const std::string& text, std::vector<std::pair<int, int>>& ranges) {
+    if (text == "-") return true;
+    std::stringstream ss(text);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        try {
+            size_t dash = part.find('-');
+            int first = std::stoi(part.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(part.substr(dash + 1));
+            if (first < 0 || last >= CLUSTER_SLOTS || first > last) return false;
+            ranges.push_back({first, last});
+        } catch (...) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Cluster::Cluster(int port)
+    : myId(generateReplId()), myPort(port), currentEpoch(0), slotOwner(CLUSTER_SLOTS),
+      running(false), busSocket(INVALID_SOCKET) {
+    nodes[myId] = {myId, "127.0.0.1", port, 0, INVALID_SOCKET, time(nullptr)};
+}
+
+Cluster::~Cluster() {
+    stop();
+}
+
+bool Cluster::start(std::function<void(const std::string&, const std::string&)> onPublish) {
+    publishHandler = onPublish;
+
+    busSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (busSocket == INVALID_SOCKET) return false;
+
+#ifndef _WIN32
+    int reuse = 1;
+    setsockopt(busSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+#endif
+
+    sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(myPort + CLUSTER_BUS_PORT_OFFSET);
+    if (bind(busSocket, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        listen(busSocket, 16) == SOCKET_ERROR) {
+        std::cerr << "Cluster bus bind failed on port " << myPort + CLUSTER_BUS_PORT_OFFSET << std::endl;
+        closesocket(busSocket);
+        busSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    running = true;
+    acceptThread = std::thread(&Cluster::busAcceptLoop, this);
+    writeThread = std::thread(&Cluster::busWriteLoop, this);
+    cronThread = std::thread(&Cluster::cronLoop, this);
+    std::cout << "Cluster mode: node " << myId << ", bus on port " << myPort + CLUSTER_BUS_PORT_OFFSET << std::endl;
+    return true;
+}
+
+// Wakes every bus thread and joins it, so none outlives the Cluster
+void Cluster::stop() {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> outboxLock(outboxMtx);
+        std::lock_guard<std::mutex> threadsLock(threadsMtx);
+        running = false;
+    }
+    outboxReady.notify_all();
+    stopRequested.notify_all();
+
+    // shutdown wakes a blocked accept on Linux, closesocket does on Windows
+    shutdown(busSocket, 2);
+    closesocket(busSocket);
+    busSocket = INVALID_SOCKET;
+    acceptThread.join();
+    writeThread.join();
+    cronThread.join();
+
+    std::unordered_map<SOCKET, std::thread> stillReading;
+    std::vector<std::thread> finished;
+    {
+        std::lock_guard<std::mutex> lock(threadsMtx);
+        for (auto& reader : readers) shutdown(reader.first, 2);
+        stillReading.swap(readers);
+        finished.swap(finishedReaders);
+    }
+    for (auto& reader : stillReading) reader.second.join();
+    for (auto& reader : finished) reader.join();
+
+    SimpleLockGuard lock(mtx);
+    for (auto& pair : nodes) {
+        if (pair.second.link != INVALID_SOCKET) {
+            closesocket(pair.second.link);
+            pair.second.link = INVALID_SOCKET;
+        }
+    }
+}
+
+void Cluster::busAcceptLoop() {
+    while (running) {
+        SOCKET sock = accept(busSocket, nullptr, nullptr);
+        if (sock == INVALID_SOCKET) continue;
+
+        std::vector<std::thread> finished;
+        {
+            std::lock_guard<std::mutex> lock(threadsMtx);
+            finished.swap(finishedReaders);
+            if (running) {
+                readers[sock] = std::thread(&Cluster::busReadLoop, this, sock);
+            } else {
+                closesocket(sock);
+            }
+        }
+        for (auto& reader : finished) reader.join();
+    }
+}
+
+void Cluster::busReadLoop(SOCKET sock) {
+    std::string peerHost = "127.0.0.1";
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getpeername(sock, (sockaddr*)&addr, &len) == 0) {
+        peerHost = inet_ntoa(addr.sin_addr);
+    }
+
+    std::string pending;
+    char buffer[4096];
+    while (running) {
+        int n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        pending.append(buffer, n);
+
+        size_t pos;
+        while ((pos = pending.find('\n')) != std::string::npos) {
+            handleBusMessage(pending.substr(0, pos), peerHost);
+            pending.erase(0, pos + 1);
+        }
+    }
+
+    // Unless stop() already took our handle, hand it over for joining
+    {
+        std::lock_guard<std::mutex> lock(threadsMtx);
+        auto it = readers.find(sock);
+        if (it != readers.end()) {
+            finishedReaders.push_back(std::move(it->second));
+            readers.erase(it);
+        }
+    }
+    closesocket(sock);
+}
+
+// Once a second: (re)connect to every known node and send our slots plus the nodes we know
+void Cluster::cronLoop() {
+    while (running) {
+        std::vector<std::pair<std::string, std::pair<std::string, int>>> unlinked;
+        {
+            SimpleLockGuard lock(mtx);
+            for (const auto& pair : nodes) {
+                if (pair.first != myId && pair.second.link == INVALID_SOCKET) {
+                    unlinked.push_back({pair.first, {pair.second.host, pair.second.port}});
+                }
+            }
+        }
+
+        // Connect without holding the lock, a dead node must not stall the slot table
+        for (const auto& node : unlinked) {
+            SOCKET sock = connectTo(node.second.first, node.second.second + CLUSTER_BUS_PORT_OFFSET);
+            if (sock == INVALID_SOCKET) continue;
+            setSendTimeout(sock, 1000);
+
+            SimpleLockGuard lock(mtx);
+            auto it = nodes.find(node.first);
+            if (it != nodes.end() && it->second.link == INVALID_SOCKET) it->second.link = sock;
+            else closesocket(sock);
+        }
+
+        std::string message;
+        {
+            SimpleLockGuard lock(mtx);
+            message = helloMessage();
+            for (const auto& pair : nodes) {
+                message += "NODE " + pair.first + " " + pair.second.host + " " + std::to_string(pair.second.port) + "\n";
+            }
+        }
+        broadcast(message);
+
+        std::unique_lock<std::mutex> lock(threadsMtx);
+        stopRequested.wait_for(lock, std::chrono::seconds(1), [this] { return !running; });
+    }
+}
+
+void Cluster::handleBusMessage(const std::string& line, const std::string& peerHost) {
+    std::stringstream ss(line);
+    std::string type;
+    ss >> type;
+
+    if (type == "HELLO") {
+        std::string id, ranges;
+        int port;
+        unsigned long long epoch;
+        if (!(ss >> id >> port >> epoch >> ranges) || id == myId) return;
+
+        std::vector<std::pair<int, int>> claimed;
+        if (!parseSlotRanges(ranges, claimed)) return;
+
+        SimpleLockGuard lock(mtx);
+        auto it = nodes.find(id);
+        if (it == nodes.end()) {
+            it = nodes.emplace(id, ClusterNode{id, peerHost, port, epoch, INVALID_SOCKET, 0}).first;
+            std::cout << "Cluster: met node " << id << " at " << peerHost << ":" << port << std::endl;
+        }
+        ClusterNode& node = it->second;
+        node.configEpoch = epoch;
+        node.lastSeen = time(nullptr);
+        currentEpoch = std::max(currentEpoch, epoch);
+
+        // A claim wins over the current owner only with a newer config epoch
+        for (const auto& range : claimed) {
+            for (int slot = range.first; slot <= range.second; ++slot) {
+                if (slotOwner[slot] == id) continue;
+                std::string owner = slotOwner[slot];
+                auto owner_it = nodes.find(owner);
+                if (owner.empty() || owner_it == nodes.end() || owner_it->second.configEpoch < epoch) {
+                    slotOwner[slot] = id;
+                    if (owner == myId) migrating.erase(slot);
+                }
+            }
+        }
+    }
+    else if (type == "NODE") {
+        std::string id, host;
+        int port;
+        if (!(ss >> id >> host >> port) || id == myId) return;
+
+        SimpleLockGuard lock(mtx);
+        if (!nodes.count(id)) {
+            nodes.emplace(id, ClusterNode{id, host, port, 0, INVALID_SOCKET, 0});
+        }
+    }
+    else if (type == "PUBLISH") {
+        std::string channel, message;
+        ss >> channel;
+        std::getline(ss >> std::ws, message);
+        if (publishHandler) publishHandler(channel, message);
+    }
+}
+
+void Cluster::broadcast(const std::string& message) {
+    std::lock_guard<std::mutex> lock(outboxMtx);
+    outbox += message;
+    outboxReady.notify_one();
+}
+
+// Sends queued messages to every linked node. The links are copied under mtx and written
+// without it; a failed (or, via SO_SNDTIMEO, stuck) link is closed and the cron loop reconnects it
+void Cluster::busWriteLoop() {
+    while (running) {
+        std::string batch;
+        {
+            std::unique_lock<std::mutex> lock(outboxMtx);
+            outboxReady.wait_for(lock, std::chrono::seconds(1), [this] { return !outbox.empty() || !running; });
+            batch.swap(outbox);
+        }
+        if (batch.empty()) continue;
+
+        std::vector<std::pair<std::string, SOCKET>> links;
+        {
+            SimpleLockGuard lock(mtx);
+            for (const auto& pair : nodes) {
+                if (pair.first != myId && pair.second.link != INVALID_SOCKET) links.push_back({pair.first, pair.second.link});
+            }
+        }
+
+        for (const auto& link : links) {
+            if (sendAll(link.second, batch)) continue;
+
+            SimpleLockGuard lock(mtx);
+            auto it = nodes.find(link.first);
+            if (it != nodes.end() && it->second.link == link.second) {
+                closesocket(it->second.link);
+                it->second.link = INVALID_SOCKET;
+            }
+        }
+    }
+}
+
+std::string Cluster::helloMessage() {
+    return "HELLO " + myId + " " + std::to_string(myPort) + " " +
+           std::to_string(nodes[myId].configEpoch) + " " + slotRanges(myId) + "\n";
+}
+
+std::string Cluster::slotRanges(const std::string& nodeId) {
+    std::string result;
+    int slot = 0;
+    while (slot < CLUSTER_SLOTS) {
+        if (slotOwner[slot] != nodeId) {
+            slot++;
+            continue;
+        }
+        int first = slot;
+        while (slot + 1 < CLUSTER_SLOTS && slotOwner[slot + 1] == nodeId) slot++;
+        if (!result.empty()) result += ",";
+        result += first == slot ? std::to_string(first) : std::to_string(first) + "-" + std::to_string(slot);
+        slot++;
+    }
+    return result.empty() ? "-" : result;
+}
+
+std::string Cluster::nodeAddress(const std::string& nodeId) {
+    auto it = nodes.find(nodeId);
+    if (it == nodes.end()) return "?";
+    return it->second.host + ":" + std::to_string(it->second.port);
+}
+
+std::string Cluster::redirect(int slot, bool asking, const std::function<bool()>& keyExistsLocally) {
+    SimpleLockGuard lock(mtx);
+    const std::string& owner = slotOwner[slot];
+
+    if (owner == myId) {
+        // While migrating, keys already moved are served by the target
+        auto it = migrating.find(slot);
+        if (it != migrating.end() && !keyExistsLocally()) {
+            return "ASK " + std::to_string(slot) + " " + nodeAddress(it->second);
+        }
+        return "";
+    }
+    if (asking && importing.count(slot)) return "";
+    if (owner.empty()) return "ERROR: CLUSTERDOWN Hash slot not served";
+    return "MOVED " + std::to_string(slot) + " " + nodeAddress(owner);
+}
+
+std::string Cluster::command(const std::string& subcommand, const std::vector<std::string>& args) {
+    if (subcommand == "MEET") {
+        if (args.size() < 2) return "ERROR: usage CLUSTER MEET host port";
+        int port;
+        try {
+            port = std::stoi(args[1]);
+        } catch (...) {
+            return "ERROR: invalid port";
+        }
+
+        // Introduce ourselves; the other node links back from its cron loop
+        SOCKET sock = connectTo(args[0], port + CLUSTER_BUS_PORT_OFFSET);
+        if (sock == INVALID_SOCKET) return "ERROR: could not reach cluster bus of " + args[0] + ":" + args[1];
+        std::string hello;
+        {
+            SimpleLockGuard lock(mtx);
+            hello = helloMessage();
+        }
+        sendAll(sock, hello);
+        closesocket(sock);
+        return "OK";
+    }
+    else if (subcommand == "MYID") {
+        return myId;
+    }
+    else if (subcommand == "KEYSLOT") {
+        if (args.empty()) return "ERROR: usage CLUSTER KEYSLOT key";
+        return std::to_string(keyHashSlot(args[0]));
+    }
+    else if (subcommand == "ADDSLOTS" || subcommand == "ADDSLOTSRANGE" || subcommand == "DELSLOTS") {
+        std::vector<int> slots;
+        try {
+            if (subcommand == "ADDSLOTSRANGE") {
+                if (args.size() < 2) return "ERROR: usage CLUSTER ADDSLOTSRANGE start end";
+                for (int slot = std::stoi(args[0]); slot <= std::stoi(args[1]); ++slot) slots.push_back(slot);
+            } else {
+                for (const auto& arg : args) slots.push_back(std::stoi(arg));
+            }
+        } catch (...) {
+            return "ERROR: invalid slot";
+        }
+
+        SimpleLockGuard lock(mtx);
+        for (int slot : slots) {
+            if (slot < 0 || slot >= CLUSTER_SLOTS) return "ERROR: invalid slot " + std::to_string(slot);
+            if (subcommand != "DELSLOTS" && !slotOwner[slot].empty()) {
+                return "ERROR: slot " + std::to_string(slot) + " is already busy";
+            }
+        }
+        for (int slot : slots) {
+            slotOwner[slot] = subcommand == "DELSLOTS" ? "" : myId;
+        }
+        return "OK";
+    }
+    else if (subcommand == "SETSLOT") {
+        if (args.size() < 2) return "ERROR: usage CLUSTER SETSLOT slot MIGRATING|IMPORTING|NODE node-id | STABLE";
+        int slot;
+        try {
+            slot = std::stoi(args[0]);
+        } catch (...) {
+            return "ERROR: invalid slot";
+        }
+        if (slot < 0 || slot >= CLUSTER_SLOTS) return "ERROR: invalid slot";
+
+        std::string action = args[1];
+        std::transform(action.begin(), action.end(), action.begin(), ::toupper);
+
+        SimpleLockGuard lock(mtx);
+        if (action == "STABLE") {
+            migrating.erase(slot);
+            importing.erase(slot);
+            return "OK";
+        }
+        if (args.size() < 3) return "ERROR: missing node id";
+        const std::string& nodeId = args[2];
+        if (!nodes.count(nodeId)) return "ERROR: unknown node " + nodeId;
+
+        if (action == "MIGRATING") {
+            if (slotOwner[slot] != myId) return "ERROR: I'm not the owner of hash slot " + args[0];
+            migrating[slot] = nodeId;
+        } else if (action == "IMPORTING") {
+            if (slotOwner[slot] == myId) return "ERROR: I'm already the owner of hash slot " + args[0];
+            importing[slot] = nodeId;
+        } else if (action == "NODE") {
+            slotOwner[slot] = nodeId;
+            migrating.erase(slot);
+            importing.erase(slot);
+
+            // Taking ownership needs a fresh epoch so the rest of the cluster accepts our claim
+            if (nodeId == myId) {
+                nodes[myId].configEpoch = ++currentEpoch;
+            }
+            broadcast(helloMessage());
+        } else {
+            return "ERROR: unknown SETSLOT action " + args[1];
+        }
+        return "OK";
+    }
+    else if (subcommand == "NODES") {
+        SimpleLockGuard lock(mtx);
+        std::stringstream ss;
+        time_t now = time(nullptr);
+        for (const auto& pair : nodes) {
+            const ClusterNode& node = pair.second;
+            ss << node.id << " " << node.host << ":" << node.port << "@" << node.port + CLUSTER_BUS_PORT_OFFSET
+               << (node.id == myId ? " myself,master" : " master")
+               << " " << node.configEpoch
+               << " " << (node.id == myId || node.link != INVALID_SOCKET ? "connected" : "disconnected")
+               << " " << (node.id == myId ? 0 : (long long)(now - node.lastSeen)) << "s"
+               << " " << slotRanges(node.id);
+            if (node.id == myId) {
+                for (const auto& m : migrating) ss << " [" << m.first << "->-" << m.second << "]";
+                for (const auto& i : importing) ss << " [" << i.first << "-<-" << i.second << "]";
+            }
+            ss << "\n";
+        }
+        std::string result = ss.str();
+        if (!result.empty()) result.pop_back();
+        return result;
+    }
+    else if (subcommand == "SLOTS") {
+        SimpleLockGuard lock(mtx);
+        std::string result;
+        int slot = 0;
+        while (slot < CLUSTER_SLOTS) {
+            if (slotOwner[slot].empty()) {
+                slot++;
+                continue;
+            }
+            int first = slot;
+            const std::string owner = slotOwner[slot];
+            while (slot + 1 < CLUSTER_SLOTS && slotOwner[slot + 1] == owner) slot++;
+            result += std::to_string(first) + "-" + std::to_string(slot) + " " + nodeAddress(owner) + " " + owner + "\n";
+            slot++;
+        }
+        if (result.empty()) return "(empty)";
+        result.pop_back();
+        return result;
+    }
+    else if (subcommand == "INFO") {
+        SimpleLockGuard lock(mtx);
+        int assigned = 0;
+        for (const auto& owner : slotOwner) {
+            if (!owner.empty()) assigned++;
+        }
+        std::stringstream ss;
+        ss << "Cluster State: " << (assigned == CLUSTER_SLOTS ? "ok" : "fail") << "\n";
+        ss << "Slots Assigned: " << assigned << "\n";
+        ss << "Known Nodes: " << nodes.size() << "\n";
+        ss << "Current Epoch: " << currentEpoch << "\n";
+        ss << "My Epoch: " << nodes[myId].configEpoch;
+        return ss.str();
+    }
+
+    return "ERROR: Unknown CLUSTER subcommand '" + subcommand + "'";
+}
+
+void Cluster::publish(const std::string& channel, const std::string& message) {
+    broadcast("PUBLISH " + channel + " " + message + "\n");
+}
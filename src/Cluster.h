@@ -0,0 +1,94 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "DataStore.h"
+#include "Platform.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+#include <ctime>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+const int CLUSTER_SLOTS = 16384;
+const int CLUSTER_BUS_PORT_OFFSET = 10000;
+
+// CRC16 (XMODEM) of the key, or of its {hash tag} when present, modulo 16384
+int keyHashSlot(const std::string& key);
+
+struct ClusterNode {
+    std::string id;
+    std::string host;
+    int port;
+    unsigned long long configEpoch;
+    SOCKET link;        // outbound cluster bus connection, INVALID_SOCKET until connected
+    time_t lastSeen;
+};
+
+// Slot table and cluster bus for one node. Nodes talk over a line based
+// protocol on port + 10000:
+//   HELLO <id> <port> <configEpoch> <slot ranges|->   sender's own slots
+//   NODE <id> <host> <port>                          gossip about other nodes
+//   PUBLISH <channel> <message>                      cluster wide PUBLISH
+class Cluster {
+private:
+    std::string myId;
+    int myPort;
+    unsigned long long currentEpoch;
+    std::unordered_map<std::string, ClusterNode> nodes;   // includes ourselves
+    std::vector<std::string> slotOwner;                  // node id per slot, "" when unassigned
+    std::unordered_map<int, std::string> migrating;      // slot -> target node id
+    std::unordered_map<int, std::string> importing;      // slot -> source node id
+    SimpleMutex mtx;
+
+    std::atomic<bool> running;
+    SOCKET busSocket;
+    std::function<void(const std::string&, const std::string&)> publishHandler;
+
+    // Messages for every linked node; only busWriteLoop writes to the links, outside mtx,
+    // so a slow peer never blocks redirect() or the command that queued the message
+    std::string outbox;
+    std::mutex outboxMtx;
+    std::condition_variable outboxReady;
+
+    // Bus threads, all joined by stop(). Inbound links are shut down there so their recv returns;
+    // a reader that ends on its own moves its handle to finishedReaders for the accept loop to join
+    std::thread acceptThread;
+    std::thread writeThread;
+    std::thread cronThread;
+    std::unordered_map<SOCKET, std::thread> readers;
+    std::vector<std::thread> finishedReaders;
+    std::mutex threadsMtx;
+    std::condition_variable stopRequested;      // wakes the cron loop's sleep
+
+    void busAcceptLoop();
+    void busReadLoop(SOCKET sock);
+    void busWriteLoop();
+    void cronLoop();
+    void handleBusMessage(const std::string& line, const std::string& peerHost);
+    void broadcast(const std::string& message);
+    std::string helloMessage();
+    std::string slotRanges(const std::string& nodeId);
+    std::string nodeAddress(const std::string& nodeId);
+
+public:
+    Cluster(int port);
+    ~Cluster();
+
+    bool start(std::function<void(const std::string&, const std::string&)> onPublish);
+    void stop();
+
+    // "" when this node serves the slot, otherwise the MOVED/ASK/CLUSTERDOWN reply
+    std::string redirect(int slot, bool asking, const std::function<bool()>& keyExistsLocally);
+
+    // CLUSTER MEET/ADDSLOTS/ADDSLOTSRANGE/DELSLOTS/SETSLOT/NODES/SLOTS/INFO/MYID/KEYSLOT
+    std::string command(const std::string& subcommand, const std::vector<std::string>& args);
+
+    void publish(const std::string& channel, const std::string& message);
+    std::string myself() const { return myId; }
+};
+
+#endif
@@ -1,30 +1,215 @@
 #include "DataStore.h" // not using namespace std here .
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+// Rough per-allocation costs used by the memory estimate
+static const size_t KEY_OVERHEAD = 96;      // meta entry plus the key's node in its type map
+static const size_t ELEMENT_OVERHEAD = 48;  // one node in a list, set or hash
+
+static const int LFU_INIT_VAL = 5;
+static const int LFU_LOG_FACTOR = 10;
+static const int LFU_DECAY_MINUTES = 1;
+static const uint32_t LRU_CLOCK_MAX = (1 << 24) - 1;
+
+static uint32_t lruClock() {
+    return (uint32_t)time(nullptr) & LRU_CLOCK_MAX;
+}
+
+static uint32_t lruIdleSeconds(uint32_t lru) {
+    uint32_t now = lruClock();
+    return now >= lru ? now - lru : (LRU_CLOCK_MAX - lru) + now;
+}
+
+// xorshift, so counting an access never touches a shared RNG or allocates
+static uint32_t fastRandom() {
+    static thread_local uint32_t state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Counter halves its chance to grow as it rises, so 255 stands for about a million hits
+static uint8_t lfuLogIncr(uint8_t counter) {
+    if (counter == 255) return 255;
+    double r = (double)fastRandom() / 4294967296.0;
+    double baseval = counter > LFU_INIT_VAL ? counter - LFU_INIT_VAL : 0;
+    double p = 1.0 / (baseval * LFU_LOG_FACTOR + 1);
+    return r < p ? counter + 1 : counter;
+}
+
+// One point lost per idle minute since the last access
+static uint8_t lfuDecr(uint8_t counter, uint32_t lru) {
+    uint32_t periods = lruIdleSeconds(lru) / 60 / LFU_DECAY_MINUTES;
+    return periods > counter ? 0 : counter - periods;
+}
+
+bool DataStore::parseInteger(const std::string& text, long long& value) {
+    size_t len = text.size();
+    if (len == 0 || len > 20) return false;
+    
+    size_t pos = 0;
+    bool negative = text[0] == '-';
+    if (negative) pos++;
+    if (pos == len) return false;
+    if (text[pos] == '0') {
+        if (len == pos + 1 && !negative) {
+            value = 0;
+            return true;
+        }
+        return false;
+    }
+    
+    unsigned long long magnitude = 0;
+    for (; pos < len; ++pos) {
+        char c = text[pos];
+        if (c < '0' || c > '9') return false;
+        if (magnitude > (ULLONG_MAX - (c - '0')) / 10) return false;
+        magnitude = magnitude * 10 + (c - '0');
+    }
+    if (negative) {
+        if (magnitude > (unsigned long long)LLONG_MAX + 1) return false;
+        value = (long long)(0 - magnitude);
+    } else {
+        if (magnitude > (unsigned long long)LLONG_MAX) return false;
+        value = (long long)magnitude;
+    }
+    return true;
+}
+
+// Only text that round-trips exactly is stored as a number, so GET returns what SET stored
+void StringValue::assign(const std::string& value) {
+    long long number;
+    if (DataStore::parseInteger(value, number)) {
+        setInt(number);
+    } else {
+        isInt = false;
+        text = value;
+    }
+}
+
+DataStore::DataStore()
+    : usedMemory(0), evictedKeys(0), evictedBytes(0), evictionPoolUsed(0),
+      eventsPending(false), notifyGate(nullptr),
+      maxmemory(0), maxmemoryPolicy(NOEVICTION), maxmemorySamples(5),
+      lazyfreeLazyExpire(0), lazyfreeLazyEviction(0), lazyfreeLazyUserDel(0),
+      notifyKeyspaceEvents(0) {}
 
 void DataStore::cleanupExpired() {
     time_t now = time(nullptr);
     auto it = expiry.begin();
     while (it != expiry.end()) {
         if (now >= it->second) {
-            strings.erase(it->first);
-            hashes.erase(it->first);
-            lists.erase(it->first);
-            sets.erase(it->first);
-            sortedSets.erase(it->first);
-            it = expiry.erase(it);
+            std::string key = it->first;
+            ++it;
+            if (removeKey(key, lazyfreeLazyExpire != 0)) notify(NOTIFY_EXPIRED, "expired", key);
         } else {
             ++it;
         }
     }
 }
 
+// Adjusts a key's estimated size; creates its meta entry on first write
+void DataStore::trackWrite(const std::string& key, long long delta) {
+    auto it = meta.find(key);
+    if (it == meta.end()) {
+        KeyMeta entry;
+        entry.lru = lruClock();
+        entry.lfu = LFU_INIT_VAL;
+        entry.bytes = KEY_OVERHEAD + key.size();
+        it = meta.emplace(key, entry).first;
+        usedMemory += entry.bytes;
+    } else {
+        recordAccess(key);
+    }
+    it->second.bytes += delta;
+    usedMemory += delta;
+}
+
+// Read path: updates the access clock and counter in place, no allocation
+void DataStore::recordAccess(const std::string& key) {
+    auto it = meta.find(key);
+    if (it == meta.end()) return;
+    
+    KeyMeta& entry = it->second;
+    if (maxmemoryPolicy == ALLKEYS_LFU) {
+        entry.lfu = lfuLogIncr(lfuDecr(entry.lfu, entry.lru));
+    }
+    entry.lru = lruClock();
+}
+
+// Every mutation goes through here so WATCHed keys and tracking clients notice the change
+void DataStore::touch(const std::string& key) {
+    if (keyChangeListener) keyChangeListener(key);
+    if (watchedKeys.empty()) return;
+    auto it = watchedKeys.find(key);
+    if (it != watchedKeys.end()) it->second.version++;
+}
+
+// Two relaxed loads when notifications are off or nobody listens; otherwise queued under the lock
+void DataStore::notify(int type, const char* event, const std::string& key) {
+    int flags = notifyKeyspaceEvents.load(std::memory_order_relaxed);
+    if (!(flags & type) || !(flags & (NOTIFY_KEYSPACE | NOTIFY_KEYEVENT))) return;
+    if (!notifyGate || notifyGate->load(std::memory_order_relaxed) == 0) return;
+    keyspaceEvents.push_back(KeyspaceEvent{event, key});
+    eventsPending.store(true, std::memory_order_relaxed);
+}
+
+bool DataStore::keyExists(const std::string& key) const {
+    return strings.count(key) || hashes.count(key) || lists.count(key) || 
+           sets.count(key) || sortedSets.count(key);
+}
+
+// Erases one typed value; big aggregates are moved out in O(1) and freed on the lazy-free thread
+template <typename Map>
+static int eraseValue(Map& map, const std::string& key, LazyFree* lazyFree) {
+    auto it = map.find(key);
+    if (it == map.end()) return 0;
+    if (lazyFree && it->second.size() > LazyFree::THRESHOLD) lazyFree->reclaim(std::move(it->second));
+    map.erase(it);
+    return 1;
+}
+
+int DataStore::removeKey(const std::string& key, bool lazy) {
+    int count = 0;
+    LazyFree* reclaimer = lazy ? &lazyFree : nullptr;
+    
+    auto meta_it = meta.find(key);
+    if (meta_it != meta.end()) {
+        usedMemory -= meta_it->second.bytes;
+        meta.erase(meta_it);
+    }
+    
+    // A string is a single allocation, never worth a hand-off
+    if (strings.erase(key)) count++;
+    count += eraseValue(hashes, key, reclaimer);
+    count += eraseValue(lists, key, reclaimer);
+    count += eraseValue(sets, key, reclaimer);
+    count += eraseValue(sortedSets, key, reclaimer);
+    expiry.erase(key);
+    
+    if (count) touch(key);
+    return count;
+}
+
 
 std::string DataStore::set(const std::string& key, const std::string& value, int ttl) {
     SimpleLockGuard lock(mtx);
     cleanupExpired();
     
-    strings[key] = value;
+    StringValue& stored = strings[key];
+    size_t oldBytes = stored.bytes();
+    stored.assign(value);
+    trackWrite(key, (long long)stored.bytes() - (long long)oldBytes);
+    touch(key);
+    notify(NOTIFY_STRING, "set", key);
     if (ttl > 0) {
         expiry[key] = time(nullptr) + ttl;
+        notify(NOTIFY_GENERIC, "expire", key);
     } else {
         expiry.erase(key);
     }
@@ -37,20 +222,21 @@ std::string DataStore::get(const std::string& key) {
     
     auto it = strings.find(key);
     if (it == strings.end()) return "(nil)";
-    return it->second;
+    recordAccess(key);
+    return it->second.str();
 }
 
 int DataStore::del(const std::string& key) {
     SimpleLockGuard lock(mtx);
-    int count = 0;
-    
-    if (strings.erase(key)) count++;
-    if (hashes.erase(key)) count++;
-    if (lists.erase(key)) count++;
-    if (sets.erase(key)) count++;
-    if (sortedSets.erase(key)) count++;
-    expiry.erase(key);
-    
+    int count = removeKey(key, lazyfreeLazyUserDel != 0);
+    if (count) notify(NOTIFY_GENERIC, "del", key);
+    return count;
+}
+
+int DataStore::unlink(const std::string& key) {
+    SimpleLockGuard lock(mtx);
+    int count = removeKey(key, true);
+    if (count) notify(NOTIFY_GENERIC, "del", key);
     return count;
 }
 
@@ -58,42 +244,94 @@ bool DataStore::exists(const std::string& key) {
     SimpleLockGuard lock(mtx);
     cleanupExpired();
     
-    return strings.count(key) || hashes.count(key) || lists.count(key) || 
-           sets.count(key) || sortedSets.count(key);
+    recordAccess(key);
+    return keyExists(key);
 }
 
-int DataStore::incr(const std::string& key) {
+std::string DataStore::incr(const std::string& key) {
+    return incrby(key, 1);
+}
+
+std::string DataStore::decr(const std::string& key) {
+    return incrby(key, -1);
+}
+
+std::string DataStore::incrby(const std::string& key, long long delta) {
     SimpleLockGuard lock(mtx);
     cleanupExpired();
     
-    try {
-        if (strings.find(key) == strings.end()) {
-            strings[key] = "0";
-        }
-        int value = std::stoi(strings[key]);
-        value++;
-        strings[key] = std::to_string(value);
-        return value;
-    } catch (...) {
-        return -1;
+    auto it = strings.find(key);
+    long long value = 0;
+    if (it != strings.end()) {
+        if (it->second.isInt) value = it->second.intValue;
+        else if (!parseInteger(it->second.text, value)) return "ERROR: value is not an integer or out of range";
+    }
+    if ((delta > 0 && value > LLONG_MAX - delta) || (delta < 0 && value < LLONG_MIN - delta)) {
+        return "ERROR: increment or decrement would overflow";
     }
+    value += delta;
+    
+    StringValue& stored = it != strings.end() ? it->second : strings[key];
+    long long oldBytes = (long long)stored.bytes();
+    stored.setInt(value);
+    trackWrite(key, (long long)stored.bytes() - oldBytes);
+    touch(key);
+    notify(NOTIFY_STRING, "incrby", key);
+    return std::to_string(value);
 }
 
-int DataStore::decr(const std::string& key) {
+// Room for any long double printed with %.17Lf (Redis' MAX_LONG_DOUBLE_CHARS)
+static const size_t MAX_LONG_DOUBLE_CHARS = 5 * 1024;
+
+// Like Redis: long double arithmetic, result stored as text without trailing zeros
+std::string DataStore::incrbyfloat(const std::string& key, long double delta) {
     SimpleLockGuard lock(mtx);
     cleanupExpired();
     
-    try {
-        if (strings.find(key) == strings.end()) {
-            strings[key] = "0";
+    auto it = strings.find(key);
+    long double value = 0;
+    if (it != strings.end()) {
+        if (it->second.isInt) {
+            value = it->second.intValue;
+        } else {
+            const std::string& text = it->second.text;
+            char* end = nullptr;
+            value = strtold(text.c_str(), &end);
+            if (text.empty() || isspace((unsigned char)text[0]) || *end != '\0' || std::isnan(value)) {
+                return "ERROR: value is not a valid float";
+            }
         }
-        int value = std::stoi(strings[key]);
-        value--;
-        strings[key] = std::to_string(value);
-        return value;
-    } catch (...) {
-        return -1;
     }
+    value += delta;
+    if (std::isnan(value) || std::isinf(value)) return "ERROR: increment would produce NaN or Infinity";
+    
+    char buffer[MAX_LONG_DOUBLE_CHARS];
+    int length = snprintf(buffer, sizeof(buffer), "%.17Lf", value);
+    if (length < 0 || (size_t)length >= sizeof(buffer)) return "ERROR: increment would produce a value that cannot be represented";
+    std::string text(buffer, length);
+    if (text.find('.') != std::string::npos) {
+        text.erase(text.find_last_not_of('0') + 1);
+        if (text.back() == '.') text.pop_back();
+    }
+    if (text == "-0") text = "0";
+    
+    StringValue& stored = it != strings.end() ? it->second : strings[key];
+    long long oldBytes = (long long)stored.bytes();
+    stored.assign(text);
+    trackWrite(key, (long long)stored.bytes() - oldBytes);
+    touch(key);
+    notify(NOTIFY_STRING, "incrbyfloat", key);
+    return text;
+}
+
+std::string DataStore::getset(const std::string& key, const std::string& value) {
+    SimpleLockGuard lock(mtx);
+    cleanupExpired();
+    
+    auto it = strings.find(key);
+    std::string old = it == strings.end() ? "(nil)" : it->second.str();
+    set(key, value);
+    return old;
 }
 
 
@@ -101,7 +339,17 @@ std::string DataStore::hset(const std::string& key, const std::string& field, co
     SimpleLockGuard lock(mtx);
     cleanupExpired();
     
-    hashes[key][field] = value;
+    auto& hash = hashes[key];
+    auto field_it = hash.find(field);
+    if (field_it == hash.end()) {
+        trackWrite(key, ELEMENT_OVERHEAD + field.size() + value.size());
+        hash.emplace(field, value);
+    } else {
+        trackWrite(key, (long long)value.size() - (long long)field_it->second.size());
+        field_it->second = value;
+    }
+    touch(key);
+    notify(NOTIFY_HASH, "hset", key);
     return "1";
 }
 
@@ -115,6 +363,7 @@ std::string DataStore::hget(const std::string& key, const std::string& field) {
     auto field_it = hash_it->second.find(field);
     if (field_it == hash_it->second.end()) return "(nil)";
     
+    recordAccess(key);
     return field_it->second;
 }
 
@@ -124,6 +373,7 @@ std::string DataStore::hgetall(const std::string& key) {
     
     auto hash_it = hashes.find(key);
     if (hash_it == hashes.end()) return "(empty)";
+    recordAccess(key);
     
     std::string result;
     for (const auto& pair : hash_it->second) {
@@ -138,6 +388,9 @@ std::string DataStore::lpush(const std::string& key, const std::string& value) {
     cleanupExpired();
     
     lists[key].insert(lists[key].begin(), value);
+    trackWrite(key, ELEMENT_OVERHEAD + value.size());
+    touch(key);
+    notify(NOTIFY_LIST, "lpush", key);
     return std::to_string(lists[key].size());
 }
 
@@ -146,6 +399,9 @@ std::string DataStore::rpush(const std::string& key, const std::string& value) {
     cleanupExpired();
     
     lists[key].push_back(value);
+    trackWrite(key, ELEMENT_OVERHEAD + value.size());
+    touch(key);
+    notify(NOTIFY_LIST, "rpush", key);
     return std::to_string(lists[key].size());
 }
 
@@ -158,6 +414,9 @@ std::string DataStore::lpop(const std::string& key) {
     
     std::string value = it->second.front();
     it->second.erase(it->second.begin());
+    trackWrite(key, -(long long)(ELEMENT_OVERHEAD + value.size()));
+    touch(key);
+    notify(NOTIFY_LIST, "lpop", key);
     return value;
 }
 
@@ -170,6 +429,9 @@ std::string DataStore::rpop(const std::string& key) {
     
     std::string value = it->second.back();
     it->second.pop_back();
+    trackWrite(key, -(long long)(ELEMENT_OVERHEAD + value.size()));
+    touch(key);
+    notify(NOTIFY_LIST, "rpop", key);
     return value;
 }
 
@@ -179,6 +441,7 @@ std::string DataStore::lrange(const std::string& key, int start, int stop) {
     
     auto it = lists.find(key);
     if (it == lists.end()) return "(empty)";
+    recordAccess(key);
     
     const auto& list = it->second;
     if (start < 0) start = list.size() + start;
@@ -199,6 +462,11 @@ std::string DataStore::sadd(const std::string& key, const std::string& member) {
     cleanupExpired();
     
     auto result = sets[key].insert(member);
+    if (result.second) {
+        trackWrite(key, ELEMENT_OVERHEAD + member.size());
+        touch(key);
+        notify(NOTIFY_SET, "sadd", key);
+    }
     return result.second ? "1" : "0";
 }
 
@@ -208,6 +476,7 @@ std::string DataStore::smembers(const std::string& key) {
     
     auto it = sets.find(key);
     if (it == sets.end()) return "(empty)";
+    recordAccess(key);
     
     std::string result;
     for (const auto& member : it->second) {
@@ -222,6 +491,7 @@ std::string DataStore::sismember(const std::string& key, const std::string& memb
     
     auto it = sets.find(key);
     if (it == sets.end()) return "0";
+    recordAccess(key);
     
     return it->second.count(member) ? "1" : "0";
 }
@@ -248,7 +518,8 @@ int DataStore::ttl(const std::string& key) {
     
     time_t now = time(nullptr);
     if (now >= it->second) {
-        del(key);
+        removeKey(key, lazyfreeLazyExpire != 0);
+        notify(NOTIFY_EXPIRED, "expired", key);
         return -2;
     }
     
@@ -257,9 +528,12 @@ int DataStore::ttl(const std::string& key) {
 
 int DataStore::expire(const std::string& key, int seconds) {
     SimpleLockGuard lock(mtx);
-    if (!exists(key)) return 0;
+    cleanupExpired();
+    if (!keyExists(key)) return 0;
     
     expiry[key] = time(nullptr) + seconds;
+    touch(key);
+    notify(NOTIFY_GENERIC, "expire", key);
     return 1;
 }
 
@@ -289,6 +563,298 @@ std::string DataStore::info() {
     ss << "Lists: " << lists.size() << "\n";
     ss << "Sets: " << sets.size() << "\n";
     ss << "Sorted Sets: " << sortedSets.size() << "\n";
+    ss << "Used Memory: " << usedMemory << " bytes\n";
+    ss << "Maxmemory: " << maxmemory << " bytes\n";
+    ss << "Maxmemory Policy: " << maxmemoryPolicyName() << "\n";
+    ss << "Evicted Keys: " << evictedKeys << "\n";
+    ss << "Evicted Bytes: " << evictedBytes << "\n";
+    ss << "Lazyfree Pending Objects: " << lazyFree.pending << "\n";
+    ss << "Lazyfreed Objects: " << lazyFree.freed << "\n";
     
     return ss.str();
-}
\ No newline at end of file
+}
+
+void DataStore::flushall(bool async) {
+    SimpleLockGuard lock(mtx);
+    
+    for (auto& pair : watchedKeys) pair.second.version++;
+    if (keyChangeListener) keyChangeListener("");
+    usedMemory = 0;
+    evictionPoolUsed = 0;
+    
+    // ASYNC swaps the whole keyspace out; the lock is held only for the moves
+    if (async) {
+        lazyFree.reclaim(std::move(meta));
+        lazyFree.reclaim(std::move(strings));
+        lazyFree.reclaim(std::move(hashes));
+        lazyFree.reclaim(std::move(lists));
+        lazyFree.reclaim(std::move(sets));
+        lazyFree.reclaim(std::move(sortedSets));
+        lazyFree.reclaim(std::move(expiry));
+    }
+    meta.clear();
+    strings.clear();
+    hashes.clear();
+    lists.clear();
+    sets.clear();
+    sortedSets.clear();
+    expiry.clear();
+}
+
+void DataStore::appendKeyCommands(const std::string& key, time_t now, std::vector<std::string>& commands) const {
+    auto str_it = strings.find(key);
+    if (str_it != strings.end()) {
+        commands.push_back("SET " + key + " " + str_it->second.str());
+    }
+    auto hash_it = hashes.find(key);
+    if (hash_it != hashes.end()) {
+        for (const auto& field : hash_it->second) {
+            commands.push_back("HSET " + key + " " + field.first + " " + field.second);
+        }
+    }
+    auto list_it = lists.find(key);
+    if (list_it != lists.end()) {
+        for (const auto& value : list_it->second) {
+            commands.push_back("RPUSH " + key + " " + value);
+        }
+    }
+    auto set_it = sets.find(key);
+    if (set_it != sets.end()) {
+        for (const auto& member : set_it->second) {
+            commands.push_back("SADD " + key + " " + member);
+        }
+    }
+    auto exp_it = expiry.find(key);
+    if (exp_it != expiry.end()) {
+        commands.push_back("EXPIRE " + key + " " + std::to_string(exp_it->second - now));
+    }
+}
+
+std::vector<std::string> DataStore::keyList() {
+    SimpleLockGuard lock(mtx);
+    cleanupExpired();
+    
+    std::set<std::string> allKeys;
+    for (const auto& pair : strings) allKeys.insert(pair.first);
+    for (const auto& pair : hashes) allKeys.insert(pair.first);
+    for (const auto& pair : lists) allKeys.insert(pair.first);
+    for (const auto& pair : sets) allKeys.insert(pair.first);
+    for (const auto& pair : sortedSets) allKeys.insert(pair.first);
+    
+    return std::vector<std::string>(allKeys.begin(), allKeys.end());
+}
+
+std::vector<std::string> DataStore::dump() {
+    SimpleLockGuard lock(mtx);
+    
+    std::vector<std::string> commands;
+    time_t now = time(nullptr);
+    for (const auto& key : keyList()) {
+        appendKeyCommands(key, now, commands);
+    }
+    return commands;
+}
+
+std::vector<std::string> DataStore::dumpKey(const std::string& key) {
+    SimpleLockGuard lock(mtx);
+    cleanupExpired();
+    
+    std::vector<std::string> commands;
+    appendKeyCommands(key, time(nullptr), commands);
+    return commands;
+}
+
+unsigned long long DataStore::watch(const std::string& key) {
+    SimpleLockGuard lock(mtx);
+    cleanupExpired();
+    
+    WatchedKey& watched = watchedKeys[key];
+    watched.watchers++;
+    return watched.version;
+}
+
+void DataStore::unwatch(const std::string& key) {
+    SimpleLockGuard lock(mtx);
+    auto it = watchedKeys.find(key);
+    if (it == watchedKeys.end()) return;
+    
+    if (--it->second.watchers <= 0) watchedKeys.erase(it);
+}
+
+unsigned long long DataStore::version(const std::string& key) {
+    SimpleLockGuard lock(mtx);
+    cleanupExpired();
+    
+    auto it = watchedKeys.find(key);
+    return it == watchedKeys.end() ? 0 : it->second.version;
+}
+
+// Higher score = better eviction candidate
+unsigned long long DataStore::evictionScore(const std::string& key, const KeyMeta& entry) {
+    switch (maxmemoryPolicy) {
+    case ALLKEYS_LFU:
+        return 255 - lfuDecr(entry.lfu, entry.lru);
+    case VOLATILE_TTL: {
+        auto it = expiry.find(key);
+        return it == expiry.end() ? 0 : ULLONG_MAX - (unsigned long long)it->second;
+    }
+    default:
+        return lruIdleSeconds(entry.lru);
+    }
+}
+
+// Samples maxmemory-samples random keys (only keys with a TTL for volatile-*) into the pool
+void DataStore::populateEvictionPool() {
+    bool volatileOnly = maxmemoryPolicy == VOLATILE_LRU || maxmemoryPolicy == VOLATILE_TTL;
+    size_t population = volatileOnly ? expiry.size() : meta.size();
+    if (population == 0) return;
+    
+    size_t buckets = volatileOnly ? expiry.bucket_count() : meta.bucket_count();
+    long long samples = std::max(1LL, maxmemorySamples.load());
+    for (long long i = 0; i < samples; ++i) {
+        // Random bucket, first key in it (walk forward past empty buckets)
+        size_t bucket = fastRandom() % buckets;
+        const std::string* key = nullptr;
+        for (size_t probe = 0; probe < buckets && !key; ++probe) {
+            size_t b = (bucket + probe) % buckets;
+            if (volatileOnly) {
+                if (expiry.begin(b) != expiry.end(b)) key = &expiry.begin(b)->first;
+            } else {
+                if (meta.begin(b) != meta.end(b)) key = &meta.begin(b)->first;
+            }
+        }
+        if (!key) return;
+        
+        auto meta_it = meta.find(*key);
+        if (meta_it == meta.end()) continue;
+        unsigned long long score = evictionScore(*key, meta_it->second);
+        
+        // Skip keys already pooled, otherwise insert keeping ascending score order
+        bool pooled = false;
+        for (int k = 0; k < evictionPoolUsed && !pooled; ++k) pooled = evictionPool[k].key == *key;
+        if (pooled) continue;
+        
+        int pos = 0;
+        while (pos < evictionPoolUsed && evictionPool[pos].score < score) pos++;
+        if (evictionPoolUsed == EVICTION_POOL_SIZE) {
+            if (pos == 0) continue;     // worse than everything pooled
+            for (int k = 0; k < pos - 1; ++k) std::swap(evictionPool[k], evictionPool[k + 1]);
+            pos--;
+        } else {
+            for (int k = evictionPoolUsed; k > pos; --k) std::swap(evictionPool[k], evictionPool[k - 1]);
+            evictionPoolUsed++;
+        }
+        evictionPool[pos].score = score;
+        evictionPool[pos].key = *key;
+    }
+}
+
+bool DataStore::freeMemoryIfNeeded(std::vector<std::string>* evicted) {
+    SimpleLockGuard lock(mtx);
+    long long limit = maxmemory;
+    if (limit <= 0 || (long long)usedMemory <= limit) return true;
+    if (maxmemoryPolicy == NOEVICTION) return false;
+    
+    cleanupExpired();
+    bool volatileOnly = maxmemoryPolicy == VOLATILE_LRU || maxmemoryPolicy == VOLATILE_TTL;
+    while ((long long)usedMemory > limit) {
+        populateEvictionPool();
+        
+        // Take the best pooled candidate that still exists and, for volatile-*, still has a TTL
+        bool freed = false;
+        while (evictionPoolUsed > 0 && !freed) {
+            PoolEntry& best = evictionPool[--evictionPoolUsed];
+            auto it = meta.find(best.key);
+            if (it == meta.end()) continue;
+            if (volatileOnly && !expiry.count(best.key)) continue;
+            
+            size_t bytes = it->second.bytes;
+            removeKey(best.key, lazyfreeLazyEviction != 0);
+            notify(NOTIFY_EVICTED, "evicted", best.key);
+            evictedKeys++;
+            evictedBytes += bytes;
+            if (evicted) evicted->push_back(best.key);
+            freed = true;
+        }
+        if (!freed) return false;
+    }
+    return true;
+}
+
+bool DataStore::setMaxmemoryPolicy(const std::string& name) {
+    SimpleLockGuard lock(mtx);
+    int policy;
+    if (name == "noeviction") policy = NOEVICTION;
+    else if (name == "allkeys-lru") policy = ALLKEYS_LRU;
+    else if (name == "volatile-lru") policy = VOLATILE_LRU;
+    else if (name == "allkeys-lfu") policy = ALLKEYS_LFU;
+    else if (name == "volatile-ttl") policy = VOLATILE_TTL;
+    else return false;
+    
+    // Pooled scores mean something else under another policy
+    maxmemoryPolicy = policy;
+    evictionPoolUsed = 0;
+    return true;
+}
+
+bool DataStore::setNotifyKeyspaceEvents(const std::string& flags) {
+    int mask = 0;
+    for (char c : flags) {
+        switch (c) {
+        case 'K': mask |= NOTIFY_KEYSPACE; break;
+        case 'E': mask |= NOTIFY_KEYEVENT; break;
+        case 'g': mask |= NOTIFY_GENERIC; break;
+        case '$': mask |= NOTIFY_STRING; break;
+        case 'l': mask |= NOTIFY_LIST; break;
+        case 's': mask |= NOTIFY_SET; break;
+        case 'h': mask |= NOTIFY_HASH; break;
+        case 'z': mask |= NOTIFY_ZSET; break;
+        case 'x': mask |= NOTIFY_EXPIRED; break;
+        case 'e': mask |= NOTIFY_EVICTED; break;
+        case 'A': mask |= NOTIFY_ALL; break;
+        default: return false;
+        }
+    }
+    notifyKeyspaceEvents = mask;
+    return true;
+}
+
+std::string DataStore::notifyKeyspaceEventsString() {
+    int mask = notifyKeyspaceEvents;
+    std::string flags;
+    if ((mask & NOTIFY_ALL) == NOTIFY_ALL) {
+        flags = "A";
+    } else {
+        if (mask & NOTIFY_GENERIC) flags += 'g';
+        if (mask & NOTIFY_STRING) flags += '$';
+        if (mask & NOTIFY_LIST) flags += 'l';
+        if (mask & NOTIFY_SET) flags += 's';
+        if (mask & NOTIFY_HASH) flags += 'h';
+        if (mask & NOTIFY_ZSET) flags += 'z';
+        if (mask & NOTIFY_EXPIRED) flags += 'x';
+        if (mask & NOTIFY_EVICTED) flags += 'e';
+    }
+    if (mask & NOTIFY_KEYSPACE) flags += 'K';
+    if (mask & NOTIFY_KEYEVENT) flags += 'E';
+    return flags;
+}
+
+// Called after every event loop batch or input batch; the flag keeps the idle case off the lock
+std::vector<KeyspaceEvent> DataStore::takeKeyspaceEvents() {
+    std::vector<KeyspaceEvent> events;
+    if (!eventsPending.load(std::memory_order_relaxed)) return events;
+    SimpleLockGuard lock(mtx);
+    events.swap(keyspaceEvents);
+    eventsPending = false;
+    return events;
+}
+
+std::string DataStore::maxmemoryPolicyName() {
+    switch (maxmemoryPolicy) {
+    case ALLKEYS_LRU: return "allkeys-lru";
+    case VOLATILE_LRU: return "volatile-lru";
+    case ALLKEYS_LFU: return "allkeys-lfu";
+    case VOLATILE_TTL: return "volatile-ttl";
+    default: return "noeviction";
+    }
+}
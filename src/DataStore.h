@@ -9,14 +9,31 @@
 #include <set>
 #include <ctime>
 #include <sstream>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <functional>
+#include "LazyFree.h"
 
+// Re-entrant spin lock: the owning thread may lock again (EXEC holds it around a whole batch)
 class SimpleMutex {
 private:
-    bool locked;
+    std::atomic<bool> locked;
+    std::atomic<std::thread::id> owner;
+    int depth;
 public:
-    SimpleMutex() : locked(false) {}
-    void lock() { while(locked) {} locked = true; }
-    void unlock() { locked = false; }
+    SimpleMutex() : locked(false), owner(std::thread::id()), depth(0) {}
+    void lock() {
+        if (owner.load() == std::this_thread::get_id()) { depth++; return; }
+        while (locked.exchange(true, std::memory_order_acquire)) { std::this_thread::yield(); }
+        owner = std::this_thread::get_id();
+        depth = 1;
+    }
+    void unlock() {
+        if (--depth > 0) return;
+        owner = std::thread::id();
+        locked.store(false, std::memory_order_release);
+    }
 };
 
 class SimpleLockGuard {
@@ -27,10 +44,33 @@ public:
     ~SimpleLockGuard() { mutex.unlock(); }
 };
 
+// String value. Canonical integers are held as int64 and only formatted when read,
+// so INCR never parses or allocates; the number lives inside the map node itself.
+struct StringValue {
+    bool isInt = false;
+    long long intValue = 0;
+    std::string text;
+    
+    void assign(const std::string& value);
+    void setInt(long long value) {
+        isInt = true;
+        intValue = value;
+        text.clear();
+    }
+    std::string str() const { return isInt ? std::to_string(intValue) : text; }
+    size_t bytes() const { return isInt ? sizeof(long long) : text.size(); }
+};
+
+// One keyspace notification, published as __keyspace@0__:<key> -> event and __keyevent@0__:<event> -> key
+struct KeyspaceEvent {
+    const char* event;
+    std::string key;
+};
+
 class DataStore {
 private:
 
-    std::unordered_map<std::string, std::string> strings;
+    std::unordered_map<std::string, StringValue> strings;
     
     // Hash data ( HSET sathi)
     std::unordered_map<std::string, std::unordered_map<std::string, std::string>> hashes;
@@ -47,18 +87,102 @@ private:
     // Expiry times
     std::unordered_map<std::string, time_t> expiry;
     
+    // WATCH version counters, kept only for keys some client is watching
+    struct WatchedKey {
+        unsigned long long version;
+        int watchers;
+    };
+    std::unordered_map<std::string, WatchedKey> watchedKeys;
+    
+    // maxmemory accounting: estimated bytes plus a 24-bit access clock and an
+    // 8-bit logarithmic (Morris) access counter per key, packed like Redis' robj
+    struct KeyMeta {
+        uint32_t lru : 24;      // last access, seconds
+        uint32_t lfu : 8;       // access frequency counter
+        size_t bytes;
+    };
+    std::unordered_map<std::string, KeyMeta> meta;
+    size_t usedMemory;
+    long long evictedKeys;
+    long long evictedBytes;
+    
+    // Eviction candidates from sampling, ordered by score (best candidate last)
+    static const int EVICTION_POOL_SIZE = 16;
+    struct PoolEntry {
+        unsigned long long score;
+        std::string key;
+    };
+    PoolEntry evictionPool[EVICTION_POOL_SIZE];
+    int evictionPoolUsed;
+    
+    // Told about every changed key ("" after FLUSHALL), with the lock held
+    std::function<void(const std::string&)> keyChangeListener;
+    
+    // Keyspace notifications wait here until the server publishes them in one batch.
+    // The gate is the number of keyspace channel subscriptions: with none, nothing is queued.
+    std::vector<KeyspaceEvent> keyspaceEvents;
+    std::atomic<bool> eventsPending;
+    const std::atomic<int>* notifyGate;
+    
+    LazyFree lazyFree;
     SimpleMutex mtx;
 
     void cleanupExpired();
+    void touch(const std::string& key);
+    bool keyExists(const std::string& key) const;
+    int removeKey(const std::string& key, bool lazy = false);
+    void appendKeyCommands(const std::string& key, time_t now, std::vector<std::string>& commands) const;
+    
+    void notify(int type, const char* event, const std::string& key);
+    void trackWrite(const std::string& key, long long delta);
+    void recordAccess(const std::string& key);
+    unsigned long long evictionScore(const std::string& key, const KeyMeta& entry);
+    void populateEvictionPool();
 
 public:
+    enum MaxmemoryPolicy { NOEVICTION, ALLKEYS_LRU, VOLATILE_LRU, ALLKEYS_LFU, VOLATILE_TTL };
+    
+    std::atomic<long long> maxmemory;          // bytes, 0 = unlimited
+    std::atomic<int> maxmemoryPolicy;
+    std::atomic<long long> maxmemorySamples;
+    
+    // Which implicit deletions hand big values to the lazy-free thread (0/1)
+    std::atomic<long long> lazyfreeLazyExpire;
+    std::atomic<long long> lazyfreeLazyEviction;
+    std::atomic<long long> lazyfreeLazyUserDel;   // DEL behaves like UNLINK
+    
+    // notify-keyspace-events classes, same letters as Redis (A = g$lshzxe)
+    enum NotifyFlags {
+        NOTIFY_KEYSPACE = 1,    // K
+        NOTIFY_KEYEVENT = 2,    // E
+        NOTIFY_GENERIC = 4,     // g: del, expire
+        NOTIFY_STRING = 8,      // $
+        NOTIFY_LIST = 16,       // l
+        NOTIFY_SET = 32,        // s
+        NOTIFY_HASH = 64,       // h
+        NOTIFY_ZSET = 128,      // z
+        NOTIFY_EXPIRED = 256,   // x
+        NOTIFY_EVICTED = 512,   // e
+        NOTIFY_ALL = 4 | 8 | 16 | 32 | 64 | 128 | 256 | 512
+    };
+    std::atomic<int> notifyKeyspaceEvents;
+    
+    DataStore();
+    
     // String operations
     std::string set(const std::string& key, const std::string& value, int ttl = 0);
     std::string get(const std::string& key);
     int del(const std::string& key);
+    int unlink(const std::string& key);
     bool exists(const std::string& key);
-    int incr(const std::string& key);
-    int decr(const std::string& key);
+    std::string incr(const std::string& key);
+    std::string decr(const std::string& key);
+    std::string incrby(const std::string& key, long long delta);
+    std::string incrbyfloat(const std::string& key, long double delta);
+    std::string getset(const std::string& key, const std::string& value);
+    
+    // Strict int64 parse (no spaces, sign only for negatives, no leading zeros)
+    static bool parseInteger(const std::string& text, long long& value);
     
     // Hash operations
     std::string hset(const std::string& key, const std::string& field, const std::string& value);
@@ -85,6 +209,32 @@ public:
     
     int dbsize();
     std::string info();
+    void flushall(bool async = false);
+    
+    // Whole dataset (or one key) as a list of commands that rebuild it (replication full sync, MIGRATE)
+    std::vector<std::string> dump();
+    std::vector<std::string> dumpKey(const std::string& key);
+    std::vector<std::string> keyList();
+    
+    // Evicts keys per maxmemory-policy until under the limit; false when that is not possible
+    bool freeMemoryIfNeeded(std::vector<std::string>* evicted = nullptr);
+    bool setMaxmemoryPolicy(const std::string& name);
+    std::string maxmemoryPolicyName();
+    
+    // Keyspace notifications: the flags string, the queued events, and the subscription count gating them
+    bool setNotifyKeyspaceEvents(const std::string& flags);
+    std::string notifyKeyspaceEventsString();
+    std::vector<KeyspaceEvent> takeKeyspaceEvents();
+    void setNotifyGate(const std::atomic<int>* subscriptions) { notifyGate = subscriptions; }
+    
+    // Transactions: WATCH bookkeeping and the lock EXEC holds around a queued batch
+    unsigned long long watch(const std::string& key);
+    void unwatch(const std::string& key);
+    unsigned long long version(const std::string& key);
+    SimpleMutex& batchLock() { return mtx; }
+    
+    // CLIENT TRACKING invalidation hook; must not call back into the DataStore
+    void setKeyChangeListener(std::function<void(const std::string&)> listener) { keyChangeListener = listener; }
 };
 
 #endif // export use for regarding datastore.cpp file
\ No newline at end of file
@@ -0,0 +1,688 @@
+#include "EventLoop.h"
+
+#ifdef __linux__
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <chrono>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+static void setBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+static bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// epoll: level-triggered readiness, one read per ready socket, one write per dirty socket
+// ---------------------------------------------------------------------------
+
+class EpollLoop : public EventLoop {
+private:
+    struct Connection {
+        std::string out;
+        size_t written = 0;
+        bool dirty = false;
+        bool closing = false;
+        bool waitingWritable = false;   // EPOLLOUT armed because the socket buffer was full
+    };
+    static const int MAX_EVENTS = 256;
+    static const size_t READ_BUFFER_SIZE = 16384;
+
+    int listenFd;
+    int epollFd;
+    Handler& handler;
+    std::unordered_map<int, Connection> connections;
+    std::vector<int> dirty;
+    std::vector<char> readBuffer;
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, op, fd, &event);
+    }
+
+    void acceptClients() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;    // EAGAIN: nothing left in the accept queue
+            connections[fd];
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+            handler.onAccept(fd);
+        }
+    }
+
+    void readClient(int fd) {
+        while (true) {
+            ssize_t n = ::recv(fd, readBuffer.data(), readBuffer.size(), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) return;
+            if (n <= 0) {
+                closeNow(fd);
+                return;
+            }
+            handler.onData(fd, readBuffer.data(), n);
+
+            // Level-triggered: a short read means the socket is drained for now
+            auto it = connections.find(fd);
+            if (it == connections.end() || it->second.closing || (size_t)n < readBuffer.size()) return;
+        }
+    }
+
+    void flush(int fd) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = it->second;
+        conn.dirty = false;
+
+        while (conn.written < conn.out.size()) {
+            ssize_t n = ::send(fd, conn.out.data() + conn.written, conn.out.size() - conn.written, MSG_NOSIGNAL);
+            if (n > 0) {
+                conn.written += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && errno == EAGAIN) {
+                if (!conn.waitingWritable) watch(fd, EPOLLIN | EPOLLOUT, EPOLL_CTL_MOD);
+                conn.waitingWritable = true;
+                return;
+            } else {
+                closeNow(fd);
+                return;
+            }
+        }
+        conn.out.clear();
+        conn.written = 0;
+        if (conn.waitingWritable) watch(fd, EPOLLIN, EPOLL_CTL_MOD);
+        conn.waitingWritable = false;
+        if (conn.closing) closeNow(fd);
+    }
+
+    void markDirty(int fd, Connection& conn) {
+        if (conn.dirty) return;
+        conn.dirty = true;
+        dirty.push_back(fd);
+    }
+
+    void closeNow(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
+        handler.onClose(fd);
+    }
+
+public:
+    EpollLoop(int listenFd, Handler& handler)
+        : listenFd(listenFd), epollFd(-1), handler(handler), readBuffer(READ_BUFFER_SIZE) {}
+
+    ~EpollLoop() {
+        for (const auto& pair : connections) ::close(pair.first);
+        if (epollFd >= 0) ::close(epollFd);
+    }
+
+    bool init() {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) return false;
+        fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL, 0) | O_NONBLOCK);
+        watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+        return true;
+    }
+
+    const char* name() const override { return "epoll"; }
+
+    void run(std::atomic<bool>& running) override {
+        epoll_event events[MAX_EVENTS];
+        while (running) {
+            int count = epoll_wait(epollFd, events, MAX_EVENTS, TICK_MS);
+            if (count < 0 && errno != EINTR) {
+                std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+                break;
+            }
+            auto iterationStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < count; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptClients();
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) flush(fd);
+                if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && connections.count(fd)) readClient(fd);
+            }
+            handler.onTick();
+
+            std::vector<int> batch;
+            batch.swap(dirty);
+            for (int fd : batch) flush(fd);
+            handler.onIteration(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - iterationStart).count());
+        }
+    }
+
+    void send(int fd, const std::string& data) override {
+        auto it = connections.find(fd);
+        if (it == connections.end() || data.empty()) return;
+        it->second.out += data;
+        markDirty(fd, it->second);
+    }
+
+    void close(int fd) override {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        it->second.closing = true;
+        markDirty(fd, it->second);
+    }
+
+    void detach(int fd, std::function<void(int)> done) override {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        setBlocking(fd);
+        Connection& conn = it->second;
+        bool ok = writeAll(fd, conn.out.data() + conn.written, conn.out.size() - conn.written);
+        connections.erase(it);
+        if (ok) {
+            done(fd);
+        } else {
+            ::close(fd);
+            handler.onClose(fd);
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// io_uring, driven through the raw syscalls (no liburing dependency).
+// Steady state needs one io_uring_enter per loop iteration: a multishot accept and one
+// multishot recv per connection stay armed, received data lands in kernel-picked buffers
+// from a provided buffer ring, and every send queued during the iteration is submitted in
+// that same call. Small replies go out from pre-registered (fixed) buffers.
+// Needs Linux 6.0+ (multishot recv); older kernels fall back to epoll.
+// ---------------------------------------------------------------------------
+
+static int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize) {
+    return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+static int ioUringRegister(int ringFd, unsigned opcode, const void* arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, ringFd, opcode, arg, count);
+}
+
+class UringLoop : public EventLoop {
+private:
+    enum Op : uint64_t { OP_ACCEPT = 1, OP_RECV = 2, OP_SEND = 3, OP_CANCEL = 4 };
+
+    static const unsigned RING_ENTRIES = 1024;
+    static const unsigned RECV_BUFFERS = 1024;         // power of two, ring size
+    static const unsigned RECV_BUFFER_SIZE = 4096;
+    static const unsigned SEND_SLOTS = 256;
+    static const unsigned SEND_SLOT_SIZE = 16384;      // larger replies are sent from the heap
+    static const unsigned short BUFFER_GROUP = 1;
+
+    // A connection is only forgotten once neither its recv nor a send is in flight,
+    // so a completion can never be attributed to a reused descriptor
+    struct Connection {
+        std::string out;            // queued replies, not yet submitted
+        std::string heapSend;       // payload of an in-flight send that did not fit a fixed slot
+        const char* sendPtr = nullptr;
+        size_t sendLeft = 0;
+        int slot = -1;
+        bool sending = false;
+        bool receiving = false;
+        bool dirty = false;
+        bool closing = false;
+        bool shutDown = false;
+        bool cancelled = false;
+        std::function<void(int)> detached;
+    };
+
+    int listenFd;
+    Handler& handler;
+    int ringFd;
+
+    // Submission and completion rings (one shared mapping)
+    void* ringMemory;
+    size_t ringBytes;
+    io_uring_sqe* sqes;
+    size_t sqesBytes;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned localTail;
+    unsigned submittedTail;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+
+    // Provided buffer ring for multishot recv
+    io_uring_buf_ring* bufRing;
+    size_t bufRingBytes;
+    char* recvBuffers;
+    uint16_t bufTail;
+
+    // Registered buffers for WRITE_FIXED sends
+    char* sendArena;
+    bool fixedBuffers;
+    std::vector<int> freeSlots;
+
+    std::unordered_map<int, Connection> connections;
+    std::vector<int> dirty;
+
+    static uint64_t tag(Op op, int fd) { return ((uint64_t)op << 32) | (uint32_t)fd; }
+
+    io_uring_sqe* nextSqe() {
+        if (localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) submit(0, nullptr);
+        io_uring_sqe* sqe = &sqes[localTail & sqMask];
+        memset(sqe, 0, sizeof(*sqe));
+        localTail++;
+        return sqe;
+    }
+
+    // Publishes queued SQEs; with a timeout, also waits for at least one completion
+    void submit(unsigned minComplete, const timespec* timeout) {
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+        unsigned toSubmit = localTail - submittedTail;
+
+        io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)timeout;
+        unsigned flags = minComplete ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0;
+
+        int submitted = ioUringEnter(ringFd, toSubmit, minComplete, flags, minComplete ? &arg : nullptr, minComplete ? sizeof(arg) : 0);
+        if (submitted > 0) submittedTail += submitted;
+    }
+
+    void provideBuffer(uint16_t bid) {
+        // Index from the ring start: the header's flexible-array wrapper shifts `bufs` by 8 bytes in C++
+        io_uring_buf* buf = (io_uring_buf*)bufRing + (bufTail & (RECV_BUFFERS - 1));
+        buf->addr = (uint64_t)(uintptr_t)(recvBuffers + (size_t)bid * RECV_BUFFER_SIZE);
+        buf->len = RECV_BUFFER_SIZE;
+        buf->bid = bid;
+        bufTail++;
+        __atomic_store_n(&bufRing->tail, bufTail, __ATOMIC_RELEASE);
+    }
+
+    void armAccept() {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listenFd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = tag(OP_ACCEPT, listenFd);
+    }
+
+    void armRecv(int fd, Connection& conn) {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->user_data = tag(OP_RECV, fd);
+        conn.receiving = true;
+    }
+
+    void submitSend(int fd, Connection& conn) {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)conn.sendPtr;
+        sqe->len = (unsigned)conn.sendLeft;
+        sqe->user_data = tag(OP_SEND, fd);
+        if (conn.slot >= 0) {
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->buf_index = (uint16_t)conn.slot;
+        } else {
+            sqe->opcode = IORING_OP_SEND;
+            sqe->msg_flags = MSG_NOSIGNAL;
+        }
+    }
+
+    // One send in flight per connection keeps replies ordered
+    void startSend(int fd, Connection& conn) {
+        if (conn.sending || conn.out.empty()) return;
+
+        if (conn.out.size() <= SEND_SLOT_SIZE && !freeSlots.empty()) {
+            conn.slot = freeSlots.back();
+            freeSlots.pop_back();
+            char* slot = sendArena + (size_t)conn.slot * SEND_SLOT_SIZE;
+            memcpy(slot, conn.out.data(), conn.out.size());
+            conn.sendPtr = slot;
+            conn.sendLeft = conn.out.size();
+            conn.out.clear();
+        } else {
+            conn.heapSend.swap(conn.out);
+            conn.out.clear();
+            conn.sendPtr = conn.heapSend.data();
+            conn.sendLeft = conn.heapSend.size();
+        }
+        conn.sending = true;
+        submitSend(fd, conn);
+    }
+
+    void releaseSend(Connection& conn) {
+        if (conn.slot >= 0) freeSlots.push_back(conn.slot);
+        conn.slot = -1;
+        conn.heapSend.clear();
+        conn.sendPtr = nullptr;
+        conn.sendLeft = 0;
+        conn.sending = false;
+    }
+
+    // Moves a connection towards close or hand-off once its output has been written
+    void settle(int fd) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = it->second;
+        if (conn.sending || !conn.out.empty()) return;
+
+        if (conn.receiving) {
+            if (conn.detached && !conn.cancelled) {
+                io_uring_sqe* sqe = nextSqe();
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = tag(OP_RECV, fd);
+                sqe->user_data = tag(OP_CANCEL, fd);
+                conn.cancelled = true;
+            } else if (conn.closing && !conn.shutDown) {
+                // Ends the multishot recv; the socket is closed when it completes
+                shutdown(fd, SHUT_RDWR);
+                conn.shutDown = true;
+            }
+            return;
+        }
+
+        std::function<void(int)> detached = conn.detached;
+        connections.erase(it);
+        if (detached) {
+            setBlocking(fd);
+            detached(fd);
+        } else {
+            ::close(fd);
+            handler.onClose(fd);
+        }
+    }
+
+    void markDirty(int fd, Connection& conn) {
+        if (conn.dirty) return;
+        conn.dirty = true;
+        dirty.push_back(fd);
+    }
+
+    void onAcceptCompletion(int res, unsigned flags) {
+        if (res >= 0) {
+            Connection& conn = connections[res];
+            armRecv(res, conn);
+            handler.onAccept(res);
+        }
+        if (!(flags & IORING_CQE_F_MORE)) armAccept();
+    }
+
+    void onRecvCompletion(int fd, int res, unsigned flags) {
+        if (flags & IORING_CQE_F_BUFFER) {
+            uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+            auto it = connections.find(fd);
+            // Bytes after a hand-off or close request are not ours to interpret
+            if (res > 0 && it != connections.end() && !it->second.detached && !it->second.closing) {
+                handler.onData(fd, recvBuffers + (size_t)bid * RECV_BUFFER_SIZE, res);
+            }
+            provideBuffer(bid);
+        }
+        if (flags & IORING_CQE_F_MORE) return;
+
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = it->second;
+        // The kernel ends a multishot recv when the buffer ring runs dry; just re-arm it
+        bool stillOpen = res > 0 || res == -ENOBUFS;
+        if (stillOpen && !conn.detached && !conn.closing) {
+            armRecv(fd, conn);
+            return;
+        }
+        conn.receiving = false;
+        // Peer closed or the socket failed: drop queued output as well
+        if (!stillOpen && !conn.detached) conn.out.clear();
+        settle(fd);
+    }
+
+    void onSendCompletion(int fd, int res) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = it->second;
+
+        if (res > 0 && (size_t)res < conn.sendLeft) {
+            conn.sendPtr += res;
+            conn.sendLeft -= res;
+            submitSend(fd, conn);
+            return;
+        }
+        releaseSend(conn);
+        if (res < 0) {
+            conn.out.clear();
+            if (!conn.detached) conn.closing = true;
+        }
+        startSend(fd, conn);
+        settle(fd);
+    }
+
+    void processCompletions() {
+        unsigned head = *cqHead;
+        while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe* cqe = &cqes[head & cqMask];
+            uint64_t userData = cqe->user_data;
+            int res = cqe->res;
+            unsigned flags = cqe->flags;
+            head++;
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+            int fd = (int)(uint32_t)userData;
+            switch (userData >> 32) {
+                case OP_ACCEPT: onAcceptCompletion(res, flags); break;
+                case OP_RECV: onRecvCompletion(fd, res, flags); break;
+                case OP_SEND: onSendCompletion(fd, res); break;
+                default: break;
+            }
+        }
+    }
+
+public:
+    UringLoop(int listenFd, Handler& handler)
+        : listenFd(listenFd), handler(handler), ringFd(-1), ringMemory(MAP_FAILED), ringBytes(0),
+          sqes((io_uring_sqe*)MAP_FAILED), sqesBytes(0), localTail(0), submittedTail(0),
+          bufRing((io_uring_buf_ring*)MAP_FAILED), bufRingBytes(0), recvBuffers(nullptr), bufTail(0),
+          sendArena(nullptr), fixedBuffers(false) {}
+
+    ~UringLoop() {
+        for (const auto& pair : connections) ::close(pair.first);
+        if (ringFd >= 0) ::close(ringFd);
+        if (ringMemory != MAP_FAILED) munmap(ringMemory, ringBytes);
+        if ((void*)sqes != MAP_FAILED) munmap(sqes, sqesBytes);
+        if ((void*)bufRing != MAP_FAILED) munmap(bufRing, bufRingBytes);
+        if (recvBuffers) munmap(recvBuffers, (size_t)RECV_BUFFERS * RECV_BUFFER_SIZE);
+        if (sendArena) munmap(sendArena, (size_t)SEND_SLOTS * SEND_SLOT_SIZE);
+    }
+
+    bool init() {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = RING_ENTRIES * 8;     // multishot requests post many completions each
+        ringFd = ioUringSetup(RING_ENTRIES, &params);
+        if (ringFd < 0) {
+            std::cerr << "io_uring_setup failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+            std::cerr << "io_uring: kernel lacks required features" << std::endl;
+            return false;
+        }
+
+        // SEND_ZC arrived in the same release as multishot recv, so it doubles as the version probe
+        std::vector<char> probeMemory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = (io_uring_probe*)probeMemory.data();
+        if (ioUringRegister(ringFd, IORING_REGISTER_PROBE, probe, 256) < 0 ||
+            probe->last_op < IORING_OP_SEND_ZC || !(probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED)) {
+            std::cerr << "io_uring: kernel too old for multishot recv" << std::endl;
+            return false;
+        }
+
+        size_t sqBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cqBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ringBytes = std::max(sqBytes, cqBytes);
+        ringMemory = mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (ringMemory == MAP_FAILED || (void*)sqes == MAP_FAILED) {
+            std::cerr << "io_uring: mapping rings failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        char* base = (char*)ringMemory;
+        sqHead = (unsigned*)(base + params.sq_off.head);
+        sqTail = (unsigned*)(base + params.sq_off.tail);
+        sqMask = *(unsigned*)(base + params.sq_off.ring_mask);
+        sqEntries = *(unsigned*)(base + params.sq_off.ring_entries);
+        cqHead = (unsigned*)(base + params.cq_off.head);
+        cqTail = (unsigned*)(base + params.cq_off.tail);
+        cqMask = *(unsigned*)(base + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(base + params.cq_off.cqes);
+        localTail = submittedTail = *sqTail;
+
+        // SQE slots map 1:1 onto the index array, so it is filled once
+        unsigned* sqArray = (unsigned*)(base + params.sq_off.array);
+        for (unsigned i = 0; i < sqEntries; ++i) sqArray[i] = i;
+
+        bufRingBytes = RECV_BUFFERS * sizeof(io_uring_buf);
+        bufRing = (io_uring_buf_ring*)mmap(nullptr, bufRingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void* buffers = mmap(nullptr, (size_t)RECV_BUFFERS * RECV_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if ((void*)bufRing == MAP_FAILED || buffers == MAP_FAILED) {
+            std::cerr << "io_uring: allocating receive buffers failed" << std::endl;
+            return false;
+        }
+        recvBuffers = (char*)buffers;
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (uint64_t)(uintptr_t)bufRing;
+        reg.ring_entries = RECV_BUFFERS;
+        reg.bgid = BUFFER_GROUP;
+        if (ioUringRegister(ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            std::cerr << "io_uring: provided buffer ring not supported: " << strerror(errno) << std::endl;
+            return false;
+        }
+        for (unsigned i = 0; i < RECV_BUFFERS; ++i) provideBuffer((uint16_t)i);
+
+        // Fixed send buffers are pinned memory; without them (RLIMIT_MEMLOCK) every send goes from the heap
+        void* arena = mmap(nullptr, (size_t)SEND_SLOTS * SEND_SLOT_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena != MAP_FAILED) {
+            sendArena = (char*)arena;
+            std::vector<iovec> iovecs(SEND_SLOTS);
+            for (unsigned i = 0; i < SEND_SLOTS; ++i) {
+                iovecs[i].iov_base = sendArena + (size_t)i * SEND_SLOT_SIZE;
+                iovecs[i].iov_len = SEND_SLOT_SIZE;
+            }
+            fixedBuffers = ioUringRegister(ringFd, IORING_REGISTER_BUFFERS, iovecs.data(), SEND_SLOTS) == 0;
+            if (!fixedBuffers) {
+                std::cerr << "io_uring: registering send buffers failed, using plain sends: " << strerror(errno) << std::endl;
+            }
+        }
+        if (fixedBuffers) {
+            for (int i = SEND_SLOTS - 1; i >= 0; --i) freeSlots.push_back(i);
+        }
+        return true;
+    }
+
+    const char* name() const override { return "io_uring"; }
+
+    void run(std::atomic<bool>& running) override {
+        armAccept();
+        timespec tick = {0, TICK_MS * 1000000L};
+        while (running) {
+            // The only syscall per iteration: submit everything queued since the last one, then wait
+            submit(1, &tick);
+            auto iterationStart = std::chrono::steady_clock::now();
+            processCompletions();
+            handler.onTick();
+
+            std::vector<int> batch;
+            batch.swap(dirty);
+            for (int fd : batch) {
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                it->second.dirty = false;
+                startSend(fd, it->second);
+                settle(fd);
+            }
+            handler.onIteration(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - iterationStart).count());
+        }
+    }
+
+    void send(int fd, const std::string& data) override {
+        auto it = connections.find(fd);
+        if (it == connections.end() || data.empty() || it->second.closing) return;
+        it->second.out += data;
+        markDirty(fd, it->second);
+    }
+
+    void close(int fd) override {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        it->second.closing = true;
+        markDirty(fd, it->second);
+    }
+
+    void detach(int fd, std::function<void(int)> done) override {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        it->second.detached = done;
+        markDirty(fd, it->second);
+    }
+};
+
+EventLoop* EventLoop::create(const std::string& backend, int listenFd, Handler& handler) {
+    if (backend == "uring") {
+        UringLoop* loop = new UringLoop(listenFd, handler);
+        if (loop->init()) return loop;
+        delete loop;
+        std::cerr << "io_uring unavailable, falling back to epoll" << std::endl;
+    }
+    EpollLoop* loop = new EpollLoop(listenFd, handler);
+    if (loop->init()) return loop;
+    delete loop;
+    return nullptr;
+}
+
+#else
+
+EventLoop* EventLoop::create(const std::string&, int, Handler&) {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <string>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// Single-threaded network backend serving every client connection from one loop
+// (Linux only). "uring" uses io_uring with multishot accept/recv, a provided buffer
+// ring and registered send buffers; "epoll" is the readiness-based fallback.
+class EventLoop {
+public:
+    // Callbacks run on the loop thread
+    class Handler {
+    public:
+        virtual ~Handler() {}
+        virtual void onAccept(int fd) = 0;
+        virtual void onData(int fd, const char* data, size_t len) = 0;
+        virtual void onClose(int fd) = 0;
+        virtual void onTick() = 0;      // after every batch of events, and at least every TICK_MS
+        virtual void onIteration(uint64_t usec) = 0;    // time one iteration took, excluding the wait
+    };
+
+    static const int TICK_MS = 50;
+
+    virtual ~EventLoop() {}
+    virtual const char* name() const = 0;
+    virtual void run(std::atomic<bool>& running) = 0;
+
+    // Output is queued and written once per loop iteration, so pipelined replies share a syscall
+    virtual void send(int fd, const std::string& data) = 0;
+    // Closes after the queued output has been written
+    virtual void close(int fd) = 0;
+    // Stops serving the connection without closing it: queued output is written, the socket is
+    // switched back to blocking mode and handed to `done` (replication links take over the socket)
+    virtual void detach(int fd, std::function<void(int)> done) = 0;
+
+    // backend: "uring" or "epoll". Falls back from io_uring to epoll when the kernel does not
+    // support it; returns nullptr when no event loop backend exists on this platform.
+    static EventLoop* create(const std::string& backend, int listenFd, Handler& handler);
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// Log-linear latency histogram in the style of HdrHistogram: values below 128
+// are counted exactly, larger ones in 64 buckets per power of two (under 2% error).
+// Recording is an index computation and an increment, no allocation.
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BUCKETS = 128;
+    static constexpr int HALF_BUCKETS = SUB_BUCKETS / 2;
+    static constexpr int MAX_SHIFT = 36;   // values up to ~2^43, over 100 days in microseconds
+
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t minValue;
+    uint64_t maxValue;
+    double sum;
+
+    static int msb(uint64_t value) {
+        int bit = 0;
+        while (value >>= 1) bit++;
+        return bit;
+    }
+
+    static size_t indexFor(uint64_t value) {
+        if (value < SUB_BUCKETS) return (size_t)value;
+        int shift = std::min(msb(value) - 6, MAX_SHIFT);
+        uint64_t mantissa = std::min<uint64_t>(value >> shift, SUB_BUCKETS - 1);
+        return SUB_BUCKETS + (shift - 1) * HALF_BUCKETS + (size_t)(mantissa - HALF_BUCKETS);
+    }
+
+    // Highest value that lands in the bucket, reported as the bucket's value
+    static uint64_t valueFor(size_t index) {
+        if (index < SUB_BUCKETS) return index;
+        int shift = (int)((index - SUB_BUCKETS) / HALF_BUCKETS) + 1;
+        uint64_t mantissa = (index - SUB_BUCKETS) % HALF_BUCKETS + HALF_BUCKETS;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram()
+        : counts(SUB_BUCKETS + MAX_SHIFT * HALF_BUCKETS, 0), total(0), minValue(UINT64_MAX), maxValue(0), sum(0) {}
+
+    void record(uint64_t value) {
+        counts[indexFor(value)]++;
+        total++;
+        sum += (double)value;
+        if (value < minValue) minValue = value;
+        if (value > maxValue) maxValue = value;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        sum = 0;
+        minValue = UINT64_MAX;
+        maxValue = 0;
+    }
+
+    // percentile in [0, 100]
+    uint64_t valueAtPercentile(double percentile) const {
+        if (total == 0) return 0;
+        uint64_t target = (uint64_t)(percentile / 100.0 * total + 0.5);
+        if (target < 1) target = 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            // The last bucket also holds everything past the range; its only known bound is the max
+            if (seen >= target) return i + 1 == counts.size() ? maxValue : std::min(valueFor(i), maxValue);
+        }
+        return maxValue;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? sum / total : 0.0; }
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "LazyFree.h"
+
+LazyFree::LazyFree() : stopping(false), pending(0), freed(0) {
+    worker = std::thread(&LazyFree::run, this);
+}
+
+LazyFree::~LazyFree() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wakeup.notify_one();
+    worker.join();
+}
+
+void LazyFree::run() {
+    std::vector<std::unique_ptr<Garbage>> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wakeup.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            batch.swap(queue);
+        }
+        // The destructors do the actual work, outside the lock
+        long long count = (long long)batch.size();
+        batch.clear();
+        pending -= count;
+        freed += count;
+    }
+}
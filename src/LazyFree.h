@@ -0,0 +1,59 @@
+#ifndef LAZYFREE_H
+#define LAZYFREE_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <type_traits>
+
+// Background reclamation thread (UNLINK, FLUSHALL ASYNC, lazy expiry/eviction).
+// A value is moved out of the keyspace in O(1) under the DataStore lock and its
+// destructor then runs here, so freeing a million-element hash stalls nobody.
+class LazyFree {
+private:
+    struct Garbage {
+        virtual ~Garbage() {}
+    };
+    template <typename T>
+    struct Holder : Garbage {
+        T value;
+        explicit Holder(T&& value) : value(std::move(value)) {}
+    };
+
+    std::vector<std::unique_ptr<Garbage>> queue;
+    std::mutex mtx;
+    std::condition_variable wakeup;
+    bool stopping;
+    std::thread worker;
+
+    void run();
+
+public:
+    // Values with this many elements or fewer are cheaper to free inline than to hand off
+    static const size_t THRESHOLD = 64;
+
+    std::atomic<long long> pending;    // queued, not yet freed
+    std::atomic<long long> freed;      // objects freed by the thread so far
+
+    LazyFree();
+    ~LazyFree();
+
+    // Takes ownership of the value's contents; the caller keeps an empty shell
+    template <typename T>
+    void reclaim(T&& value) {
+        typedef typename std::decay<T>::type Value;
+        std::unique_ptr<Garbage> garbage(new Holder<Value>(std::move(value)));
+        pending++;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            queue.push_back(std::move(garbage));
+        }
+        wakeup.notify_one();
+    }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "Platform.h"
+
+SOCKET connectTo(const std::string& host, int port) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+    
+    sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(host == "localhost" ? "127.0.0.1" : host.c_str());
+    if (connect(sock, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+bool sendAll(SOCKET sock, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = send(sock, data.data() + sent, (int)(data.size() - sent), 0);
+        if (n == SOCKET_ERROR || n == 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Reads one '\n' terminated line, keeping whatever follows it in pending
+bool readLine(SOCKET sock, std::string& pending, std::string& line) {
+    char buffer[4096];
+    while (true) {
+        size_t pos = pending.find('\n');
+        if (pos != std::string::npos) {
+            line = pending.substr(0, pos);
+            pending.erase(0, pos + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        int n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+        pending.append(buffer, n);
+    }
+}
+
+bool setNonBlocking(SOCKET sock) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags != -1 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// True when the last send/recv failed only because the socket buffer was full (or empty)
+bool wouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// A blocking send that cannot make progress for this long fails instead of waiting forever
+bool setSendTimeout(SOCKET sock, int milliseconds) {
+#ifdef _WIN32
+    DWORD timeout = milliseconds;
+#else
+    timeval timeout = {milliseconds / 1000, (milliseconds % 1000) * 1000};
+#endif
+    return setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout)) == 0;
+}
@@ -0,0 +1,60 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// Socket and console portability: Winsock on Windows, BSD sockets elsewhere,
+// so several servers can also run side by side on one Linux box
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX    // keep std::min/std::max usable
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <conio.h>
+
+#pragma comment(lib, "ws2_32.lib")
+
+#else
+
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <cstring>
+
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define closesocket close
+#define MAKEWORD(a, b) 0
+
+struct WSADATA {};
+inline int WSAStartup(int, WSADATA*) { signal(SIGPIPE, SIG_IGN); return 0; }
+inline int WSACleanup() { return 0; }
+inline int WSAGetLastError() { return errno; }
+
+// No non-blocking keyboard polling on POSIX; stop the server with Ctrl+C
+inline int _kbhit() { return 0; }
+inline int _getch() { return 0; }
+
+#endif
+
+#include <string>
+
+// Small blocking helpers shared by replication, cluster bus and MIGRATE
+SOCKET connectTo(const std::string& host, int port);
+bool sendAll(SOCKET sock, const std::string& data);
+bool readLine(SOCKET sock, std::string& pending, std::string& line);
+
+// Non-blocking sockets, for links that must never stall their writer
+bool setNonBlocking(SOCKET sock);
+bool wouldBlock();
+bool setSendTimeout(SOCKET sock, int milliseconds);
+
+#endif
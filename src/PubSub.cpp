@@ -1,9 +1,14 @@
 #include "PubSub.h"
 
+bool PubSub::isKeyspaceChannel(const std::string& channel) {
+    return channel.compare(0, 11, "__keyspace@") == 0 || channel.compare(0, 11, "__keyevent@") == 0;
+}
+
 int PubSub::subscribe(const std::string& channel) {
     PubSubLockGuard lock(mtx);
     int clientId = nextClientId++;
     channels[channel].insert(clientId);
+    if (isKeyspaceChannel(channel)) keyspaceSubscriptions++;
     return clientId;
 }
 
@@ -11,18 +16,29 @@ void PubSub::unsubscribe(int clientId, const std::string& channel) {
     PubSubLockGuard lock(mtx);
     auto it = channels.find(channel);
     if (it != channels.end()) {
-        it->second.erase(clientId);
+        if (it->second.erase(clientId) && isKeyspaceChannel(channel)) keyspaceSubscriptions--;
     }
 }
 
-void PubSub::publish(const std::string& channel, const std::string& message) {
-    PubSubLockGuard lock(mtx);
+// Caller holds the lock
+int PubSub::deliver(const std::string& channel, const std::string& message) {
     auto it = channels.find(channel);
-    if (it != channels.end()) {
-        for (int clientId : it->second) {
-            clientMessages[clientId].push_back("[" + channel + "] " + message);
-        }
+    if (it == channels.end()) return 0;
+    
+    for (int clientId : it->second) {
+        clientMessages[clientId].push_back("[" + channel + "] " + message);
     }
+    return it->second.size();
+}
+
+int PubSub::publish(const std::string& channel, const std::string& message) {
+    PubSubLockGuard lock(mtx);
+    return deliver(channel, message);
+}
+
+void PubSub::publishBatch(const std::vector<std::pair<std::string, std::string>>& messages) {
+    PubSubLockGuard lock(mtx);
+    for (const auto& message : messages) deliver(message.first, message.second);
 }
 
 std::vector<std::string> PubSub::getMessages(int clientId) {
@@ -34,4 +50,29 @@ std::vector<std::string> PubSub::getMessages(int clientId) {
         return messages;
     }
     return {};
-}
\ No newline at end of file
+}
+
+int PubSub::registerClient() {
+    PubSubLockGuard lock(mtx);
+    return nextClientId++;
+}
+
+void PubSub::subscribe(int clientId, const std::string& channel) {
+    PubSubLockGuard lock(mtx);
+    if (channels[channel].insert(clientId).second && isKeyspaceChannel(channel)) keyspaceSubscriptions++;
+}
+
+void PubSub::unregisterClient(int clientId) {
+    PubSubLockGuard lock(mtx);
+    for (auto it = channels.begin(); it != channels.end(); ) {
+        if (it->second.erase(clientId) && isKeyspaceChannel(it->first)) keyspaceSubscriptions--;
+        if (it->second.empty()) it = channels.erase(it);
+        else ++it;
+    }
+    clientMessages.erase(clientId);
+}
+
+void PubSub::push(int clientId, const std::string& channel, const std::string& message) {
+    PubSubLockGuard lock(mtx);
+    clientMessages[clientId].push_back("[" + channel + "] " + message);
+}
@@ -6,15 +6,17 @@
 #include <unordered_map>
 #include <vector>
 #include <set>
+#include <atomic>
+#include <thread>
 
 // mutex for PubSub , so that each thread is isolated and locked for that context 
 class PubSubMutex {
 private:
-    bool locked;
+    std::atomic<bool> locked;
 public:
     PubSubMutex() : locked(false) {}
-    void lock() { while(locked) {} locked = true; }
-    void unlock() { locked = false; }
+    void lock() { while (locked.exchange(true, std::memory_order_acquire)) { std::this_thread::yield(); } }
+    void unlock() { locked.store(false, std::memory_order_release); }
 };
 
 class PubSubLockGuard {
@@ -31,14 +33,29 @@ private:
     std::unordered_map<int, std::vector<std::string>> clientMessages;
     PubSubMutex mtx;
     int nextClientId;
+    
+    static bool isKeyspaceChannel(const std::string& channel);
+    int deliver(const std::string& channel, const std::string& message);
 
 public:
-    PubSub() : nextClientId(1) {}
+    // Subscriptions to __keyspace@/__keyevent@ channels; DataStore skips queueing events while zero
+    std::atomic<int> keyspaceSubscriptions;
+    
+    PubSub() : nextClientId(1), keyspaceSubscriptions(0) {}
     
     int subscribe(const std::string& channel);
     void unsubscribe(int clientId, const std::string& channel);
-    void publish(const std::string& channel, const std::string& message);
+    int publish(const std::string& channel, const std::string& message);
+    void publishBatch(const std::vector<std::pair<std::string, std::string>>& messages);
     std::vector<std::string> getMessages(int clientId);
+    
+    // Connection-level subscribers: one id per connection, many channels
+    int registerClient();
+    void subscribe(int clientId, const std::string& channel);
+    void unregisterClient(int clientId);
+    
+    // Queues a message for one connection only (CLIENT TRACKING invalidations)
+    void push(int clientId, const std::string& channel, const std::string& message);
 };
 
 #endif
\ No newline at end of file
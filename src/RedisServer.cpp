@@ -2,10 +2,108 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
-#include <conio.h>  
 #include <thread>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 
-RedisServer::RedisServer(int port) : port(port), running(false), serverSocket(INVALID_SOCKET) {}
+// What the generic checks in processCommand need to know about a command
+enum CommandFlags {
+    CMD_WRITE = 1,      // changes the dataset: rejected on replicas and streamed to them from the primary
+    CMD_DENYOOM = 2,    // can grow the dataset: refused with OOM when maxmemory cannot be met
+    CMD_NOMULTI = 4,    // changes connection or server state: refused between MULTI and EXEC
+    CMD_KEY = 8,        // first argument is a key: routed by hash slot in cluster mode, tracked for CLIENT TRACKING
+};
+
+struct CommandSpec {
+    const char* name;
+    int flags;
+};
+
+// Every command the server dispatches, in HELP order. INFO commandstats is keyed by these names,
+// so a new command needs exactly one row here
+static const CommandSpec COMMAND_TABLE[] = {
+    {"SET", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"GET", CMD_KEY},
+    {"GETSET", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"DEL", CMD_WRITE | CMD_KEY},
+    {"EXISTS", CMD_KEY},
+    {"INCR", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"DECR", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"INCRBY", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"DECRBY", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"INCRBYFLOAT", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"HSET", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"HGET", CMD_KEY},
+    {"HGETALL", CMD_KEY},
+    {"LPUSH", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"RPUSH", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"LPOP", CMD_WRITE | CMD_KEY},
+    {"RPOP", CMD_WRITE | CMD_KEY},
+    {"LRANGE", CMD_KEY},
+    {"SADD", CMD_WRITE | CMD_DENYOOM | CMD_KEY},
+    {"SMEMBERS", CMD_KEY},
+    {"SISMEMBER", CMD_KEY},
+    {"KEYS", 0},
+    {"DBSIZE", 0},
+    {"UNLINK", CMD_WRITE | CMD_KEY},
+    {"FLUSHDB", CMD_WRITE},
+    {"FLUSHALL", CMD_WRITE},
+    {"INFO", 0},
+    {"TTL", CMD_KEY},
+    {"EXPIRE", CMD_WRITE | CMD_KEY},
+    {"MULTI", 0},
+    {"EXEC", 0},
+    {"DISCARD", 0},
+    {"WATCH", 0},
+    {"UNWATCH", 0},
+    {"REPLICAOF", CMD_NOMULTI},
+    {"SLAVEOF", CMD_NOMULTI},
+    {"REPLCONF", CMD_NOMULTI},
+    {"SUBSCRIBE", CMD_NOMULTI},
+    {"UNSUBSCRIBE", CMD_NOMULTI},
+    {"PUBLISH", 0},
+    {"CLUSTER", CMD_NOMULTI},
+    {"MIGRATE", CMD_NOMULTI},
+    {"ASKING", CMD_NOMULTI},
+    {"CLIENT", CMD_NOMULTI},
+    {"CONFIG", 0},
+    {"SLOWLOG", 0},
+    {"LATENCY", 0},
+    {"PING", 0},
+    {"HELP", 0},
+    {"QUIT", 0},
+};
+
+// The table row for an upper-cased command name, nullptr for unknown commands
+static const CommandSpec* lookupCommand(const std::string& cmd) {
+    static const std::unordered_map<std::string, const CommandSpec*> index = [] {
+        std::unordered_map<std::string, const CommandSpec*> names;
+        for (const auto& spec : COMMAND_TABLE) names[spec.name] = &spec;
+        return names;
+    }();
+    auto it = index.find(cmd);
+    return it == index.end() ? nullptr : it->second;
+}
+
+static bool commandHas(const std::string& cmd, int flag) {
+    const CommandSpec* spec = lookupCommand(cmd);
+    return spec && (spec->flags & flag);
+}
+
+static const char* OOM_ERROR = "ERROR: OOM command not allowed when used memory > 'maxmemory'.";
+
+RedisServer::RedisServer(int port, bool clusterEnabled)
+    : tracking(pubSub), running(false), port(port), serverSocket(INVALID_SOCKET),
+      replId(generateReplId()), secondReplOffset(-1), nextReplicaId(1),
+      replOutputBufferLimit(256LL * 1024 * 1024), isReplica(false), masterPort(0), replLinkGeneration(0),
+      masterLinkUp(false), masterLastIo(0), replicaLazyFlush(0), ioBackend("threads"),
+      nextLoopSerial(0) {
+    if (clusterEnabled) cluster.reset(new Cluster(port));
+    dataStore.setKeyChangeListener([this](const std::string& key) { tracking.invalidate(key); });
+    dataStore.setNotifyGate(&pubSub.keyspaceSubscriptions);
+}
 
 RedisServer::~RedisServer() {
     stop();
@@ -30,6 +128,11 @@ bool RedisServer::start() {
     serverAddr.sin_addr.s_addr = INADDR_ANY;
     serverAddr.sin_port = htons(port);
 
+#ifndef _WIN32
+    int reuse = 1;
+    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+#endif
+
     if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
         std::cerr << "Bind failed" << std::endl;
         closesocket(serverSocket);
@@ -37,13 +140,23 @@ bool RedisServer::start() {
         return false;
     }
 
-    if (listen(serverSocket, 10) == SOCKET_ERROR) {
+    // A short accept queue drops bursts of connects, and clients then wait forever for the banner
+    if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
         std::cerr << "Listen failed" << std::endl;
         closesocket(serverSocket);
         WSACleanup();
         return false;
     }
 
+    // Messages arriving over the cluster bus go to local subscribers only
+    if (cluster && !cluster->start([this](const std::string& channel, const std::string& message) {
+            pubSub.publish(channel, message);
+        })) {
+        closesocket(serverSocket);
+        WSACleanup();
+        return false;
+    }
+
     running = true;
     std::cout << "Redis-like server started on port " << port << std::endl;
     std::cout << "Server supports: SET, GET, DEL, INCR, HSET, HGET, LPUSH, RPUSH, INFO, etc." << std::endl;
@@ -52,6 +165,9 @@ bool RedisServer::start() {
 
 void RedisServer::stop() {
     running = false;
+    replLinkGeneration++;
+    dropReplicas();
+    if (cluster) cluster->stop();
     if (serverSocket != INVALID_SOCKET) {
         closesocket(serverSocket);
         serverSocket = INVALID_SOCKET;
@@ -59,7 +175,25 @@ void RedisServer::stop() {
     WSACleanup();
 }
 
-std::string RedisServer::processCommand(const std::string& command) {
+// Runs one client command and records its latency for commandstats, SLOWLOG and LATENCY
+std::string RedisServer::call(const std::string& command, ClientContext& ctx) {
+    auto start = std::chrono::steady_clock::now();
+    std::string response = processCommand(command, ctx);
+    uint64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    
+    size_t begin = command.find_first_not_of(' ');
+    std::string name = begin == std::string::npos ? "" : command.substr(begin, command.find(' ', begin) - begin);
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    
+    // Unknown names share one entry so junk input cannot grow the stats table
+    const CommandSpec* spec = lookupCommand(name);
+    commandStats.record(spec ? spec->name : "UNKNOWN", usec);
+    slowLog.record(command, usec);
+    latencyMonitor.record("command", usec);
+    return response;
+}
+
+std::string RedisServer::processCommand(const std::string& command, ClientContext& ctx) {
     std::stringstream ss(command);
     std::string cmd;
     ss >> cmd;
@@ -67,6 +201,270 @@ std::string RedisServer::processCommand(const std::string& command) {
     // Convert to uppercase
     std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
     
+    bool asking = ctx.asking;
+    ctx.asking = false;
+    
+    if (cmd == "MULTI") {
+        if (ctx.inMulti) return "ERROR: MULTI calls can not be nested";
+        ctx.inMulti = true;
+        ctx.multiError = false;
+        ctx.queued.clear();
+        return "OK";
+    }
+    else if (cmd == "EXEC") {
+        if (!ctx.inMulti) return "ERROR: EXEC without MULTI";
+        return execTransaction(ctx);
+    }
+    else if (cmd == "DISCARD") {
+        if (!ctx.inMulti) return "ERROR: DISCARD without MULTI";
+        ctx.inMulti = false;
+        ctx.queued.clear();
+        unwatchAll(ctx);
+        return "OK";
+    }
+    else if (cmd == "WATCH") {
+        if (ctx.inMulti) return "ERROR: WATCH inside MULTI is not allowed";
+        std::string key;
+        while (ss >> key) {
+            if (ctx.watched.count(key)) continue;
+            ctx.watched[key] = dataStore.watch(key);
+        }
+        return "OK";
+    }
+    else if (cmd == "UNWATCH") {
+        unwatchAll(ctx);
+        return "OK";
+    }
+    
+    // Commands that change connection or server state take effect immediately, so they
+    // cannot be part of a transaction; like any queueing error they abort the EXEC.
+    // That includes ASKING: its one-shot flag would be spent on the next queued command.
+    if (ctx.inMulti && commandHas(cmd, CMD_NOMULTI)) {
+        ctx.multiError = true;
+        return "ERROR: Command not allowed inside a transaction";
+    }
+    
+    if (cmd == "REPLICAOF" || cmd == "SLAVEOF") {
+        std::string host, portArg;
+        ss >> host >> portArg;
+        return replicaOf(host, portArg);
+    }
+    else if (cmd == "ASKING") {
+        if (!cluster) return "ERROR: This instance has cluster support disabled";
+        ctx.asking = true;
+        return "OK";
+    }
+    else if (cmd == "CLUSTER") {
+        return clusterCommand(ss);
+    }
+    else if (cmd == "SUBSCRIBE") {
+        if (!ctx.pubsubId) ctx.pubsubId = pubSub.registerClient();
+        std::string channel, result;
+        while (ss >> channel) {
+            pubSub.subscribe(ctx.pubsubId, channel);
+            result += "Subscribed to " + channel + "\n";
+        }
+        if (result.empty()) return "ERROR: usage SUBSCRIBE channel [channel ...]";
+        result.pop_back();
+        return result;
+    }
+    else if (cmd == "UNSUBSCRIBE") {
+        std::string channel;
+        while (ss >> channel) {
+            if (ctx.pubsubId) pubSub.unsubscribe(ctx.pubsubId, channel);
+        }
+        return "OK";
+    }
+    else if (cmd == "MIGRATE") {
+        std::string host, portArg, key;
+        ss >> host >> portArg >> key;
+        return migrateKey(host, portArg, key);
+    }
+    else if (cmd == "CLIENT") {
+        return clientCommand(ss, ctx);
+    }
+    else if (cmd == "REPLCONF") {
+        std::string option;
+        ss >> option;
+        std::transform(option.begin(), option.end(), option.begin(), ::tolower);
+        if (option == "listening-port") ss >> ctx.replicaPort;
+        return "OK";
+    }
+    
+    bool isWrite = commandHas(cmd, CMD_WRITE);
+    if (isWrite && isReplica && !ctx.isMaster) {
+        if (ctx.inMulti) ctx.multiError = true;
+        return "ERROR: READONLY You can't write against a read only replica.";
+    }
+    
+    if (cluster && commandHas(cmd, CMD_KEY)) {
+        std::string key;
+        ss >> key;
+        std::string redirect = cluster->redirect(keyHashSlot(key), asking || ctx.isMaster,
+                                                 [&]() { return dataStore.exists(key); });
+        if (!redirect.empty()) {
+            if (ctx.inMulti) ctx.multiError = true;
+            return redirect;
+        }
+    }
+    
+    if (ctx.inMulti && cmd != "QUIT") {
+        if (cmd.empty()) {
+            ctx.multiError = true;
+            return "ERROR: empty command";
+        }
+        if (!lookupCommand(cmd)) {
+            ctx.multiError = true;
+            return "ERROR: Unknown command '" + cmd + "'. Type HELP for available commands.";
+        }
+        ctx.queued.push_back(command);
+        return "QUEUED";
+    }
+    
+    if (!isWrite) {
+        trackRead(command, ctx);
+        return executeCommand(command);
+    }
+    
+    // Execute and append to the replication stream as one step, so replicas see writes in apply order
+    SimpleLockGuard batch(dataStore.batchLock());
+    if (!ctx.isMaster && !evictIfNeeded() && commandHas(cmd, CMD_DENYOOM)) return OOM_ERROR;
+    std::string result = executeCommand(command);
+    if (!ctx.isMaster) propagate(command);
+    return result;
+}
+
+// Runs the queued commands as one batch under the DataStore lock, unless a WATCHed key changed
+std::string RedisServer::execTransaction(ClientContext& ctx) {
+    std::vector<std::string> queued;
+    queued.swap(ctx.queued);
+    ctx.inMulti = false;
+    
+    if (ctx.multiError) {
+        unwatchAll(ctx);
+        return "ERROR: EXECABORT Transaction discarded because of previous errors.";
+    }
+    
+    std::string result;
+    {
+        SimpleLockGuard batch(dataStore.batchLock());
+        
+        for (const auto& pair : ctx.watched) {
+            if (dataStore.version(pair.first) != pair.second) {
+                result = "(nil)";
+                break;
+            }
+        }
+        
+        if (result.empty() && !ctx.isMaster && !evictIfNeeded()) {
+            for (const auto& queuedCommand : queued) {
+                std::string name = queuedCommand.substr(0, queuedCommand.find(' '));
+                std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+                if (commandHas(name, CMD_DENYOOM)) {
+                    result = OOM_ERROR;
+                    break;
+                }
+            }
+        }
+        
+        if (result.empty()) {
+            std::vector<std::string> writes;
+            for (size_t i = 0; i < queued.size(); ++i) {
+                trackRead(queued[i], ctx);
+                result += std::to_string(i + 1) + ") " + executeCommand(queued[i]) + "\n";
+                
+                std::string name = queued[i].substr(0, queued[i].find(' '));
+                std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+                if (commandHas(name, CMD_WRITE)) writes.push_back(queued[i]);
+            }
+            if (result.empty()) result = "(empty)";
+            else result.pop_back();
+            
+            // Replicas apply the writes as a transaction too
+            if (!ctx.isMaster && !writes.empty()) {
+                propagate("MULTI");
+                for (const auto& write : writes) propagate(write);
+                propagate("EXEC");
+            }
+        }
+    }
+    
+    unwatchAll(ctx);
+    return result;
+}
+
+void RedisServer::unwatchAll(ClientContext& ctx) {
+    for (const auto& pair : ctx.watched) {
+        dataStore.unwatch(pair.first);
+    }
+    ctx.watched.clear();
+}
+
+// Drops everything a closing connection registered: WATCHes, subscriptions, tracking
+void RedisServer::releaseClient(ClientContext& ctx) {
+    unwatchAll(ctx);
+    if (ctx.tracking) tracking.disable(ctx.pubsubId);
+    if (ctx.pubsubId) pubSub.unregisterClient(ctx.pubsubId);
+    ctx.tracking = false;
+    ctx.pubsubId = 0;
+}
+
+// Default-mode tracking: remembered before the read runs, so a write racing with it
+// still sends the invalidation
+void RedisServer::trackRead(const std::string& command, ClientContext& ctx) {
+    if (!ctx.tracking) return;
+    std::stringstream ss(command);
+    std::string cmd, key;
+    ss >> cmd >> key;
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+    if (commandHas(cmd, CMD_KEY) && !commandHas(cmd, CMD_WRITE) && !key.empty()) tracking.remember(ctx.pubsubId, key);
+}
+
+// CLIENT TRACKING ON [BCAST] [PREFIX prefix ...] | CLIENT TRACKING OFF
+std::string RedisServer::clientCommand(std::stringstream& ss, ClientContext& ctx) {
+    std::string subcommand, mode, option;
+    ss >> subcommand >> mode;
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+    if (subcommand != "TRACKING" || (mode != "ON" && mode != "OFF")) {
+        return "ERROR: usage CLIENT TRACKING ON [BCAST] [PREFIX prefix ...] | CLIENT TRACKING OFF";
+    }
+    
+    if (mode == "OFF") {
+        if (ctx.tracking) tracking.disable(ctx.pubsubId);
+        ctx.tracking = false;
+        return "OK";
+    }
+    
+    bool bcast = false;
+    std::vector<std::string> prefixes;
+    while (ss >> option) {
+        std::string name = option;
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        if (name == "BCAST") {
+            bcast = true;
+        } else if (name == "PREFIX" && ss >> option) {
+            prefixes.push_back(option);
+        } else {
+            return "ERROR: Unknown CLIENT TRACKING option '" + option + "'";
+        }
+    }
+    if (!prefixes.empty() && !bcast) return "ERROR: PREFIX is only valid with BCAST";
+    
+    // Invalidations travel like PubSub messages, so the connection needs a PubSub id
+    if (!ctx.pubsubId) ctx.pubsubId = pubSub.registerClient();
+    tracking.enable(ctx.pubsubId, bcast, prefixes);
+    ctx.tracking = true;
+    return "OK";
+}
+
+std::string RedisServer::executeCommand(const std::string& command) {
+    std::stringstream ss(command);
+    std::string cmd;
+    ss >> cmd;
+    
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+    
     if (cmd == "SET") {
         std::string key, value;
         ss >> key >> value;
@@ -83,6 +481,20 @@ std::string RedisServer::processCommand(const std::string& command) {
         int result = dataStore.del(key);
         return std::to_string(result);
     }
+    else if (cmd == "UNLINK") {
+        std::string key;
+        ss >> key;
+        int result = dataStore.unlink(key);
+        return std::to_string(result);
+    }
+    else if (cmd == "FLUSHDB" || cmd == "FLUSHALL") {
+        std::string mode;
+        ss >> mode;
+        std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+        if (!mode.empty() && mode != "ASYNC" && mode != "SYNC") return "ERROR: usage " + cmd + " [ASYNC|SYNC]";
+        dataStore.flushall(mode == "ASYNC");
+        return "OK";
+    }
     else if (cmd == "EXISTS") {
         std::string key;
         ss >> key;
@@ -91,14 +503,36 @@ std::string RedisServer::processCommand(const std::string& command) {
     else if (cmd == "INCR") {
         std::string key;
         ss >> key;
-        int result = dataStore.incr(key);
-        return result >= 0 ? std::to_string(result) : "ERROR";
+        return dataStore.incr(key);
     }
     else if (cmd == "DECR") {
         std::string key;
         ss >> key;
-        int result = dataStore.decr(key);
-        return result >= 0 ? std::to_string(result) : "ERROR";
+        return dataStore.decr(key);
+    }
+    else if (cmd == "INCRBY" || cmd == "DECRBY") {
+        std::string key, arg;
+        long long delta;
+        ss >> key >> arg;
+        if (!DataStore::parseInteger(arg, delta)) return "ERROR: value is not an integer or out of range";
+        if (cmd == "DECRBY") {
+            if (delta == LLONG_MIN) return "ERROR: decrement would overflow";
+            delta = -delta;
+        }
+        return dataStore.incrby(key, delta);
+    }
+    else if (cmd == "INCRBYFLOAT") {
+        std::string key, arg;
+        ss >> key >> arg;
+        char* end = nullptr;
+        long double delta = strtold(arg.c_str(), &end);
+        if (arg.empty() || *end != '\0' || std::isnan(delta) || std::isinf(delta)) return "ERROR: value is not a valid float";
+        return dataStore.incrbyfloat(key, delta);
+    }
+    else if (cmd == "GETSET") {
+        std::string key, value;
+        ss >> key >> value;
+        return dataStore.getset(key, value);
     }
     else if (cmd == "HSET") {
         std::string key, field, value;
@@ -156,6 +590,15 @@ std::string RedisServer::processCommand(const std::string& command) {
         ss >> key >> member;
         return dataStore.sismember(key, member);
     }
+    else if (cmd == "PUBLISH") {
+        std::string channel, message;
+        ss >> channel;
+        std::getline(ss >> std::ws, message);
+        if (channel.empty()) return "ERROR: usage PUBLISH channel message";
+        int receivers = pubSub.publish(channel, message);
+        if (cluster) cluster->publish(channel, message);
+        return std::to_string(receivers);
+    }
     else if (cmd == "KEYS") {
         std::string pattern;
         ss >> pattern;
@@ -165,7 +608,18 @@ std::string RedisServer::processCommand(const std::string& command) {
         return std::to_string(dataStore.dbsize());
     }
     else if (cmd == "INFO") {
-        return dataStore.info();
+        std::string section;
+        ss >> section;
+        return infoCommand(section);
+    }
+    else if (cmd == "CONFIG") {
+        return configCommand(ss);
+    }
+    else if (cmd == "SLOWLOG") {
+        return slowlogCommand(ss);
+    }
+    else if (cmd == "LATENCY") {
+        return latencyCommand(ss);
     }
     else if (cmd == "TTL") {
         std::string key;
@@ -187,7 +641,10 @@ std::string RedisServer::processCommand(const std::string& command) {
         return "BYE";
     }
     else if (cmd == "HELP") {
-        return "Available commands: SET, GET, DEL, EXISTS, INCR, DECR, HSET, HGET, HGETALL, LPUSH, RPUSH, LPOP, RPOP, LRANGE, SADD, SMEMBERS, SISMEMBER, KEYS, DBSIZE, INFO, TTL, EXPIRE, PING, QUIT";
+        std::string result = "Available commands:";
+        for (const auto& spec : COMMAND_TABLE) result += std::string(" ") + spec.name + ",";
+        result.pop_back();
+        return result;
     }
     else {
         return "ERROR: Unknown command '" + cmd + "'. Type HELP for available commands.";
@@ -201,6 +658,7 @@ void RedisServer::startConsoleUI() {
     std::cout << "Type commands (SET key value, GET key, INFO, HELP, QUIT)" << std::endl;
     
     std::string command;
+    ClientContext ctx;
     while (running) {
         std::cout << "> ";
         std::getline(std::cin, command);
@@ -211,14 +669,71 @@ void RedisServer::startConsoleUI() {
         }
         
         if (!command.empty()) {
-            std::string response = processCommand(command);
+            std::string response = call(command, ctx);
             std::cout << response << std::endl;
+            flushKeyspaceEvents();
+            
+            if (ctx.pubsubId) {
+                for (const auto& message : pubSub.getMessages(ctx.pubsubId)) {
+                    std::cout << message << std::endl;
+                }
+            }
+        }
+    }
+}
+
+// Commands that wait on another server; the event loop runs them on a worker thread
+static bool waitsOnNetwork(const std::string& command) {
+    std::stringstream ss(command);
+    std::string cmd, subcommand;
+    ss >> cmd >> subcommand;
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    return cmd == "MIGRATE" || (cmd == "CLUSTER" && subcommand == "MEET");
+}
+
+// Answers every complete line in `pending` (pipelined commands) into `responses`.
+// Returns true when the connection is finished: after QUIT, or at a PSYNC line, which is
+// left in `psync` because the connection then becomes a replication link.
+// With `blocking`, a command that waits on the network also stops the batch and is left there.
+bool RedisServer::processInput(std::string& pending, ClientContext& ctx, std::string& responses, std::string& psync,
+                               std::string* blocking) {
+    size_t start = 0, pos;
+    bool done = false;
+    while (!done && (pos = pending.find('\n', start)) != std::string::npos) {
+        std::string command = pending.substr(start, pos - start);
+        start = pos + 1;
+        command.erase(std::remove(command.begin(), command.end(), '\r'), command.end());
+        
+        if (command.compare(0, 6, "PSYNC ") == 0 || command == "PSYNC") {
+            psync = command;
+            done = true;
+        }
+        else if (blocking && !ctx.inMulti && waitsOnNetwork(command)) {
+            *blocking = command;
+            break;
+        }
+        else if (!command.empty()) {
+            responses += call(command, ctx) + "\n";
+            done = command == "QUIT";
         }
     }
+    pending.erase(0, start);
+    return done;
+}
+
+void RedisServer::startReplicaLink(SOCKET clientSocket, const std::string& psync, ClientContext& ctx) {
+    std::stringstream ss(psync);
+    std::string command, requestedId;
+    long long requestedOffset = -1;
+    ss >> command >> requestedId >> requestedOffset;
+    syncReplica(clientSocket, requestedId, requestedOffset, ctx);
 }
 
 void RedisServer::handleClient(SOCKET clientSocket) {
-    char buffer[1024];
+    char buffer[16384];
+    std::string pending;
+    ClientContext ctx;
     
     std::cout << "Client connected! Ready for commands." << std::endl;
     
@@ -226,29 +741,33 @@ void RedisServer::handleClient(SOCKET clientSocket) {
     send(clientSocket, welcome.c_str(), welcome.length(), 0);
     
     while (running) {
-        memset(buffer, 0, sizeof(buffer));
+        // Subscribers wait with a short timeout so published messages are pushed while idle
+        if (ctx.pubsubId) {
+            flushKeyspaceEvents();
+            deliverMessages(clientSocket, ctx);
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(clientSocket, &readSet);
+            timeval timeout = {0, 50000};
+            if (select((int)clientSocket + 1, &readSet, nullptr, nullptr, &timeout) == 0) continue;
+        }
         
-        int bytesReceived = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+        int bytesReceived = recv(clientSocket, buffer, sizeof(buffer), 0);
         
         if (bytesReceived > 0) {
-            buffer[bytesReceived] = '\0';
-            std::string command(buffer);
+            auto iterationStart = std::chrono::steady_clock::now();
+            pending.append(buffer, bytesReceived);
             
-            // Remove carriage return and newline characters
-            command.erase(std::remove(command.begin(), command.end(), '\r'), command.end());
-            command.erase(std::remove(command.begin(), command.end(), '\n'), command.end());
+            std::string responses, psync;
+            bool done = processInput(pending, ctx, responses, psync);
+            flushKeyspaceEvents();
             
-            if (!command.empty()) {
-                std::cout << "Client command: " << command << std::endl;
-                std::string response = processCommand(command) + "\n";
-                
-                // Send ONLY the command response back to client
-                send(clientSocket, response.c_str(), response.length(), 0);
-                
-                if (command == "QUIT") {
-                    break;
-                }
-            }
+            // Send ONLY the command responses back to client
+            if (!responses.empty()) sendAll(clientSocket, responses);
+            latencyMonitor.record("eventloop", std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - iterationStart).count());
+            if (!psync.empty()) startReplicaLink(clientSocket, psync, ctx);
+            if (done) break;
         } else if (bytesReceived == 0) {
             // Client disconnected gracefully
             std::cout << "Client disconnected" << std::endl;
@@ -260,10 +779,98 @@ void RedisServer::handleClient(SOCKET clientSocket) {
         }
     }
     
+    releaseClient(ctx);
     closesocket(clientSocket);
     std::cout << "Client handling finished" << std::endl;
 }
 
+// Event loop callbacks: same command path as handleClient, but all clients share one thread
+
+void RedisServer::onAccept(int fd) {
+    loopClients[fd].serial = ++nextLoopSerial;
+    eventLoop->send(fd, "Welcome to Redis-like Server! Type HELP for commands.\n");
+}
+
+void RedisServer::onData(int fd, const char* data, size_t len) {
+    auto it = loopClients.find(fd);
+    if (it == loopClients.end()) return;
+    it->second.pending.append(data, len);
+    if (!it->second.blocked) serveLoopClient(fd, it->second);
+}
+
+// Answers the client's buffered commands, up to a PSYNC, QUIT or a command that waits on the network
+void RedisServer::serveLoopClient(int fd, LoopClient& client) {
+    std::string responses, psync, blocking;
+    bool done = processInput(client.pending, client.ctx, responses, psync, &blocking);
+    if (!responses.empty()) eventLoop->send(fd, responses);
+    
+    if (!psync.empty()) {
+        // The replication link reads ACKs on its own thread; propagate() only appends to its buffer
+        ClientContext ctx = client.ctx;
+        releaseClient(client.ctx);
+        loopClients.erase(fd);
+        eventLoop->detach(fd, [this, psync, ctx](int socket) {
+            std::thread([this, socket, psync, ctx]() mutable {
+                startReplicaLink(socket, psync, ctx);
+                closesocket(socket);
+            }).detach();
+        });
+    }
+    else if (done) {
+        eventLoop->close(fd);
+    }
+    else if (!blocking.empty()) {
+        // The worker runs on a copy of the connection state, which onTick puts back with the reply
+        client.blocked = true;
+        unsigned long long serial = client.serial;
+        ClientContext ctx = client.ctx;
+        std::thread([this, fd, serial, blocking, ctx]() mutable {
+            std::string response = call(blocking, ctx);
+            SimpleLockGuard lock(blockedMtx);
+            blockedReplies.push_back({fd, serial, response, ctx});
+        }).detach();
+    }
+}
+
+void RedisServer::onClose(int fd) {
+    auto it = loopClients.find(fd);
+    if (it == loopClients.end()) return;
+    releaseClient(it->second.ctx);
+    loopClients.erase(it);
+}
+
+// Runs after every batch of events: resumes clients whose blocked command finished, then
+// pushes published messages to subscribers with one batched send per subscriber
+void RedisServer::onTick() {
+    std::vector<BlockedReply> finished;
+    {
+        SimpleLockGuard lock(blockedMtx);
+        finished.swap(blockedReplies);
+    }
+    for (auto& reply : finished) {
+        auto it = loopClients.find(reply.fd);
+        if (it == loopClients.end() || it->second.serial != reply.serial) continue;   // closed meanwhile
+        it->second.ctx = reply.ctx;
+        it->second.blocked = false;
+        eventLoop->send(reply.fd, reply.response + "\n");
+        serveLoopClient(reply.fd, it->second);
+    }
+    
+    flushKeyspaceEvents();
+    for (auto& pair : loopClients) {
+        if (!pair.second.ctx.pubsubId) continue;
+        std::string out;
+        for (const auto& message : pubSub.getMessages(pair.second.ctx.pubsubId)) {
+            out += message + "\n";
+        }
+        if (!out.empty()) eventLoop->send(pair.first, out);
+    }
+}
+
+void RedisServer::onIteration(uint64_t usec) {
+    latencyMonitor.record("eventloop", usec);
+}
+
 void RedisServer::run() {
     std::cout << "\n=== Redis Server ===" << std::endl;
     std::cout << "Choose mode:" << std::endl;
@@ -280,13 +887,27 @@ void RedisServer::run() {
     } else {
         // Network-only mode (no console interference)
         std::cout << "Network server started on port " << port << std::endl;
+        if (cluster) std::cout << "Cluster node " << cluster->myself() << std::endl;
+        
+        if (ioBackend != "threads") {
+            eventLoop.reset(EventLoop::create(ioBackend, (int)serverSocket, *this));
+            if (!eventLoop) std::cerr << "No event loop backend on this platform, using threads" << std::endl;
+        }
+        std::cout << "I/O backend: " << (eventLoop ? eventLoop->name() : "threads") << std::endl;
         std::cout << "Waiting for clients... (Press Ctrl+C to stop)" << std::endl;
         
+        if (eventLoop) {
+            eventLoop->run(running);
+            eventLoop.reset();
+            loopClients.clear();
+        }
+        
         while (running) {
             SOCKET clientSocket = accept(serverSocket, nullptr, nullptr);
             if (clientSocket != INVALID_SOCKET) {
                 std::cout << "New client connected!" << std::endl;
-                handleClient(clientSocket);
+                // One thread per connection so MULTI/WATCH state is really per client
+                std::thread(&RedisServer::handleClient, this, clientSocket).detach();
             }
             
             // Check if we should stop
@@ -301,4 +922,662 @@ void RedisServer::run() {
     }
     
     std::cout << "Server shutdown complete." << std::endl;
-}
\ No newline at end of file
+}
+
+// Appends to the backlog and to each replica's output buffer; the replica threads do the
+// socket writes, so a slow replica never holds up the writer (or the batch lock it runs under)
+void RedisServer::propagate(const std::string& command) {
+    SimpleLockGuard lock(replMtx);
+    std::string line = command + "\n";
+    backlog.feed(line);
+    if (replicaLinks.empty()) return;
+    
+    size_t limit = (size_t)replOutputBufferLimit.load();
+    for (auto it = replicaLinks.begin(); it != replicaLinks.end(); ) {
+        if (limit && it->second.output.size() + line.size() > limit) {
+            // Like client-output-buffer-limit: the replica resyncs once it catches up with its reads
+            std::cout << "Replica " << it->first << " exceeded repl-output-buffer-limit, disconnecting" << std::endl;
+            shutdown(it->second.sock, 2);
+            it = replicaLinks.erase(it);
+        } else {
+            it->second.output += line;
+            ++it;
+        }
+    }
+    replWake.notify_all();
+}
+
+void RedisServer::dropReplicas() {
+    SimpleLockGuard lock(replMtx);
+    for (auto& pair : replicaLinks) {
+        shutdown(pair.second.sock, 2);
+    }
+    replicaLinks.clear();
+    replWake.notify_all();
+}
+
+// Primary side of PSYNC: partial resync from the backlog when possible, else full snapshot,
+// then the connection only carries the command stream out and REPLCONF ACKs back.
+// Only the snapshot copy and the link registration happen under the locks; this thread
+// writes the payload and the buffered stream afterwards on a non-blocking socket.
+void RedisServer::syncReplica(SOCKET clientSocket, const std::string& requestedId, long long requestedOffset, ClientContext& ctx) {
+    int id;
+    bool canContinue;
+    long long startOffset;
+    std::string missing;
+    std::vector<std::string> snapshot;
+    {
+        SimpleLockGuard batch(dataStore.batchLock());
+        SimpleLockGuard lock(replMtx);
+        
+        canContinue = requestedOffset >= 0 &&
+            (requestedId == replId || (requestedId == replId2 && requestedOffset <= secondReplOffset)) &&
+            backlog.readFrom(requestedOffset, missing);
+        startOffset = canContinue ? requestedOffset : backlog.offset();
+        if (!canContinue) snapshot = dataStore.dump();
+        
+        // Writes from here on queue up in the link's output behind the payload
+        id = nextReplicaId++;
+        sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        std::string address = "unknown";
+        if (getpeername(clientSocket, (sockaddr*)&addr, &len) == 0) {
+            address = std::string(inet_ntoa(addr.sin_addr)) + ":" + std::to_string(ctx.replicaPort);
+        }
+        replicaLinks[id] = {clientSocket, std::string()};
+        replicas.push_back({id, address, startOffset, time(nullptr)});
+        
+        std::cout << "Replica " << address << (canContinue ? " continued from offset " : " full resync at offset ")
+                  << startOffset << std::endl;
+    }
+    
+    std::string out;
+    if (canContinue) {
+        out = "CONTINUE " + replId + "\n" + missing;
+    } else {
+        out = "FULLRESYNC " + replId + " " + std::to_string(startOffset) + " " + std::to_string(snapshot.size()) + "\n";
+        for (const auto& line : snapshot) out += line + "\n";
+        std::vector<std::string>().swap(snapshot);
+    }
+    missing.clear();
+    
+    setNonBlocking(clientSocket);
+    size_t written = 0;
+    std::string pending;
+    char buffer[4096];
+    while (running) {
+        if (written == out.size()) {
+            // Everything written: take whatever propagate() queued, waiting briefly if nothing is
+            out.clear();
+            written = 0;
+            std::unique_lock<SimpleMutex> lock(replMtx);
+            auto link = replicaLinks.find(id);
+            if (link != replicaLinks.end() && link->second.output.empty()) {
+                replWake.wait_for(lock, std::chrono::milliseconds(100));
+                link = replicaLinks.find(id);
+            }
+            if (link == replicaLinks.end()) break;   // over the output limit, or dropped by a resync
+            out.swap(link->second.output);
+        }
+        
+        fd_set readSet, writeSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        FD_SET(clientSocket, &readSet);
+        if (written < out.size()) FD_SET(clientSocket, &writeSet);
+        timeval timeout = {0, written < out.size() ? 100000 : 0};
+        int ready = select((int)clientSocket + 1, &readSet, &writeSet, nullptr, &timeout);
+        if (ready < 0) break;
+        
+        if (FD_ISSET(clientSocket, &writeSet)) {
+            int n = send(clientSocket, out.data() + written, (int)(out.size() - written), 0);
+            if (n == SOCKET_ERROR && !wouldBlock()) break;
+            if (n > 0) written += n;
+        }
+        
+        if (FD_ISSET(clientSocket, &readSet)) {
+            int n = recv(clientSocket, buffer, sizeof(buffer), 0);
+            if (n == 0 || (n == SOCKET_ERROR && !wouldBlock())) break;
+            if (n > 0) pending.append(buffer, n);
+            
+            size_t pos;
+            while ((pos = pending.find('\n')) != std::string::npos) {
+                std::stringstream ss(pending.substr(0, pos));
+                pending.erase(0, pos + 1);
+                std::string replconf, ack;
+                long long offset;
+                if (!(ss >> replconf >> ack >> offset)) continue;
+                SimpleLockGuard lock(replMtx);
+                for (auto& replica : replicas) {
+                    if (replica.id == id) {
+                        replica.ackOffset = offset;
+                        replica.lastAck = time(nullptr);
+                    }
+                }
+            }
+        }
+    }
+    
+    SimpleLockGuard lock(replMtx);
+    replicaLinks.erase(id);
+    for (auto it = replicas.begin(); it != replicas.end(); ++it) {
+        if (it->id == id) {
+            std::cout << "Replica " << it->address << " disconnected" << std::endl;
+            replicas.erase(it);
+            break;
+        }
+    }
+}
+
+std::string RedisServer::replicaOf(const std::string& host, const std::string& portArg) {
+    std::string upperHost = host;
+    std::transform(upperHost.begin(), upperHost.end(), upperHost.begin(), ::toupper);
+    
+    if (upperHost == "NO" && (portArg == "ONE" || portArg == "one")) {
+        if (!isReplica) return "OK";
+        replLinkGeneration++;
+        
+        // Keep the old stream id valid so sibling replicas can partially resync against us
+        SimpleLockGuard lock(replMtx);
+        replId2 = replId;
+        secondReplOffset = backlog.offset();
+        replId = generateReplId();
+        isReplica = false;
+        masterLinkUp = false;
+        std::cout << "Promoted to primary" << std::endl;
+        return "OK";
+    }
+    
+    int newPort = 0;
+    try {
+        newPort = std::stoi(portArg);
+    } catch (...) {
+        return "ERROR: usage REPLICAOF host port | REPLICAOF NO ONE";
+    }
+    
+    int generation;
+    {
+        SimpleLockGuard lock(replMtx);
+        masterHost = host;
+        masterPort = newPort;
+        isReplica = true;
+        masterLinkUp = false;
+        generation = ++replLinkGeneration;
+    }
+    std::thread(&RedisServer::replicationLoop, this, generation).detach();
+    return "OK";
+}
+
+// Replica side: connect, PSYNC, then apply the primary's stream until the link breaks, and retry
+void RedisServer::replicationLoop(int generation) {
+    while (running && replLinkGeneration == generation) {
+        std::string host;
+        int masterPortCopy;
+        std::string requestedId;
+        long long requestedOffset;
+        {
+            SimpleLockGuard lock(replMtx);
+            host = masterHost;
+            masterPortCopy = masterPort;
+            requestedId = replId;
+            requestedOffset = backlog.offset();
+        }
+        
+        SOCKET sock = connectTo(host, masterPortCopy);
+        
+        std::string pending, line;
+        if (sock == INVALID_SOCKET || !readLine(sock, pending, line) ||
+            !sendAll(sock, "REPLCONF listening-port " + std::to_string(port) + "\n") ||
+            !readLine(sock, pending, line) ||
+            !sendAll(sock, "PSYNC " + requestedId + " " + std::to_string(requestedOffset) + "\n") ||
+            !readLine(sock, pending, line)) {
+            if (sock != INVALID_SOCKET) closesocket(sock);
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+        
+        std::stringstream header(line);
+        std::string reply, newId;
+        header >> reply >> newId;
+        
+        if (reply == "FULLRESYNC") {
+            long long offset = 0;
+            size_t count = 0;
+            header >> offset >> count;
+            
+            std::vector<std::string> snapshot;
+            bool complete = true;
+            for (size_t i = 0; i < count && complete; ++i) {
+                complete = readLine(sock, pending, line);
+                snapshot.push_back(line);
+            }
+            if (!complete) {
+                closesocket(sock);
+                continue;
+            }
+            
+            SimpleLockGuard batch(dataStore.batchLock());
+            dataStore.flushall(replicaLazyFlush != 0);
+            for (const auto& command : snapshot) executeCommand(command);
+            
+            // Our own replicas follow a stream that no longer exists
+            dropReplicas();
+            SimpleLockGuard lock(replMtx);
+            replId = newId;
+            replId2.clear();
+            secondReplOffset = -1;
+            backlog.reset(offset);
+            std::cout << "Full resync from " << host << ":" << masterPortCopy << " (" << count << " commands)" << std::endl;
+        } else if (reply == "CONTINUE") {
+            SimpleLockGuard lock(replMtx);
+            replId = newId;
+            std::cout << "Partial resync from " << host << ":" << masterPortCopy << " at offset " << requestedOffset << std::endl;
+        } else {
+            closesocket(sock);
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+        
+        masterLinkUp = true;
+        masterLastIo = time(nullptr);
+        ClientContext masterCtx;
+        masterCtx.isMaster = true;
+        
+        char buffer[4096];
+        while (running && replLinkGeneration == generation) {
+            // Apply every complete line; the raw bytes also feed our backlog and sub-replicas
+            size_t pos;
+            while ((pos = pending.find('\n')) != std::string::npos) {
+                std::string command = pending.substr(0, pos);
+                pending.erase(0, pos + 1);
+                processCommand(command, masterCtx);
+                propagate(command);
+            }
+            flushKeyspaceEvents();
+            
+            std::string ack = "REPLCONF ACK " + std::to_string(backlog.offset()) + "\n";
+            if (!sendAll(sock, ack)) break;
+            
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(sock, &readSet);
+            timeval timeout = {1, 0};
+            int ready = select((int)sock + 1, &readSet, nullptr, nullptr, &timeout);
+            if (ready < 0) break;
+            if (ready == 0) continue;
+            
+            int n = recv(sock, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            pending.append(buffer, n);
+            masterLastIo = time(nullptr);
+        }
+        
+        masterLinkUp = false;
+        closesocket(sock);
+        if (replLinkGeneration == generation) {
+            std::cout << "Lost connection to primary, retrying" << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+}
+
+std::string RedisServer::replicationInfo() {
+    SimpleLockGuard lock(replMtx);
+    std::stringstream ss;
+    time_t now = time(nullptr);
+    
+    ss << "Role: " << (isReplica ? "replica" : "master") << "\n";
+    if (isReplica) {
+        ss << "Master: " << masterHost << ":" << masterPort << "\n";
+        ss << "Master Link: " << (masterLinkUp ? "up" : "down") << "\n";
+        ss << "Master Last IO: " << (masterLastIo ? (long long)(now - masterLastIo) : -1) << " seconds ago\n";
+    }
+    ss << "Replication ID: " << replId << "\n";
+    ss << "Replication Offset: " << backlog.offset() << "\n";
+    ss << "Backlog: " << backlog.offset() - backlog.firstOffset() << "/" << backlog.size() << " bytes\n";
+    ss << "Connected Replicas: " << replicas.size() << "\n";
+    for (const auto& replica : replicas) {
+        ss << "Replica " << replica.id << ": " << replica.address
+           << " offset=" << replica.ackOffset
+           << " lag=" << backlog.offset() - replica.ackOffset << " bytes"
+           << " buffered=" << (replicaLinks.count(replica.id) ? replicaLinks[replica.id].output.size() : 0) << " bytes"
+           << " last_ack=" << (long long)(now - replica.lastAck) << "s\n";
+    }
+    return ss.str();
+}
+
+void RedisServer::deliverMessages(SOCKET clientSocket, ClientContext& ctx) {
+    std::string out;
+    for (const auto& message : pubSub.getMessages(ctx.pubsubId)) {
+        out += message + "\n";
+    }
+    if (!out.empty()) sendAll(clientSocket, out);
+}
+
+// Publishes the keyspace notifications queued since the last call in one PubSub batch
+void RedisServer::flushKeyspaceEvents() {
+    std::vector<KeyspaceEvent> events = dataStore.takeKeyspaceEvents();
+    if (events.empty()) return;
+    
+    int flags = dataStore.notifyKeyspaceEvents;
+    std::vector<std::pair<std::string, std::string>> messages;
+    messages.reserve(events.size() * 2);
+    for (const auto& event : events) {
+        if (flags & DataStore::NOTIFY_KEYSPACE) messages.emplace_back("__keyspace@0__:" + event.key, event.event);
+        if (flags & DataStore::NOTIFY_KEYEVENT) messages.emplace_back(std::string("__keyevent@0__:") + event.event, event.key);
+    }
+    pubSub.publishBatch(messages);
+}
+
+std::string RedisServer::clusterCommand(std::stringstream& ss) {
+    if (!cluster) return "ERROR: This instance has cluster support disabled";
+    
+    std::string subcommand, arg;
+    std::vector<std::string> args;
+    ss >> subcommand;
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    while (ss >> arg) args.push_back(arg);
+    
+    // The slot table lives in Cluster, the keys live here
+    if (subcommand == "GETKEYSINSLOT" || subcommand == "COUNTKEYSINSLOT") {
+        int slot, count = -1;
+        try {
+            slot = std::stoi(args.at(0));
+            if (subcommand == "GETKEYSINSLOT") count = std::stoi(args.at(1));
+        } catch (...) {
+            return "ERROR: usage CLUSTER " + subcommand + " slot" + (subcommand == "GETKEYSINSLOT" ? " count" : "");
+        }
+        
+        std::string result;
+        int found = 0;
+        for (const auto& key : dataStore.keyList()) {
+            if (keyHashSlot(key) != slot) continue;
+            if (count >= 0 && found >= count) break;
+            found++;
+            result += key + "\n";
+        }
+        if (subcommand == "COUNTKEYSINSLOT") return std::to_string(found);
+        if (result.empty()) return "(empty)";
+        result.pop_back();
+        return result;
+    }
+    return cluster->command(subcommand, args);
+}
+
+// Sends ASKING plus one command to a MIGRATE target and reads the command's reply
+static bool askTarget(SOCKET sock, std::string& pending, const std::string& command, std::string& reply) {
+    std::string asking;
+    return sendAll(sock, "ASKING\n" + command + "\n") && readLine(sock, pending, asking) && readLine(sock, pending, reply);
+}
+
+// Copies one key to another node (as ASKING + rebuild commands) and deletes it here.
+// The target must not hold the key yet; a copy left by a failed transfer is deleted again.
+std::string RedisServer::migrateKey(const std::string& host, const std::string& portArg, const std::string& key) {
+    int targetPort;
+    try {
+        targetPort = std::stoi(portArg);
+    } catch (...) {
+        return "ERROR: usage MIGRATE host port key";
+    }
+    
+    if ((host == "127.0.0.1" || host == "localhost") && targetPort == port) {
+        return "ERROR: MIGRATE target is this server";
+    }
+    
+    // Copy the key and pin its WATCH version under the lock; the network round trips run without it,
+    // so two nodes migrating to each other (or a slow target) never hold up other writers
+    std::vector<std::string> commands;
+    unsigned long long version;
+    {
+        SimpleLockGuard batch(dataStore.batchLock());
+        commands = dataStore.dumpKey(key);
+        if (commands.empty()) return "NOKEY";
+        version = dataStore.watch(key);
+    }
+    
+    std::string pending, line;
+    SOCKET sock = connectTo(host, targetPort);
+    bool connected = sock != INVALID_SOCKET;
+    bool ok = connected && readLine(sock, pending, line) && askTarget(sock, pending, "EXISTS " + key, line);
+    bool busy = ok && line == "1";
+    bool written = false;
+    for (size_t i = 0; ok && !busy && i < commands.size(); ++i) {
+        written = true;
+        ok = askTarget(sock, pending, commands[i], line) &&
+             line.compare(0, 5, "ERROR") != 0 && line.compare(0, 5, "MOVED") != 0;
+    }
+    
+    // Delete our copy only if nobody wrote the key while it was in flight
+    bool unchanged;
+    {
+        SimpleLockGuard batch(dataStore.batchLock());
+        unchanged = dataStore.version(key) == version;
+        dataStore.unwatch(key);
+        if (ok && !busy && unchanged) {
+            dataStore.del(key);
+            propagate("DEL " + key);
+        }
+    }
+    
+    // Otherwise the key must stay on this side only: drop whatever part of it reached the target
+    if (written && !(ok && unchanged)) {
+        std::string reason = line;
+        if (!ok) {
+            closesocket(sock);
+            pending.clear();
+            sock = connectTo(host, targetPort);
+            if (sock != INVALID_SOCKET && !readLine(sock, pending, line)) {
+                closesocket(sock);
+                sock = INVALID_SOCKET;
+            }
+        }
+        if (sock != INVALID_SOCKET) askTarget(sock, pending, "DEL " + key, line);
+        line = reason;
+    }
+    if (sock != INVALID_SOCKET) closesocket(sock);
+    
+    if (!connected) return "ERROR: IOERR could not connect to " + host + ":" + portArg;
+    if (!ok) return "ERROR: IOERR target rejected key: " + line;
+    if (busy) return "ERROR: BUSYKEY Target key name already exists.";
+    if (!unchanged) return "ERROR: key was modified during MIGRATE, kept the local copy";
+    return "OK";
+}
+
+// INFO [default|all|server|replication|commandstats]
+std::string RedisServer::infoCommand(const std::string& section) {
+    std::string name = section;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (name.empty()) name = "default";
+    
+    std::string result;
+    if (name == "default" || name == "all" || name == "server") {
+        result += dataStore.info();
+        result += std::string("IO Backend: ") + (eventLoop ? eventLoop->name() : "threads") + "\n";
+        result += tracking.info();
+    }
+    if (name == "default" || name == "all" || name == "replication") result += replicationInfo();
+    if (name == "all" || name == "commandstats") result += commandStats.info();
+    if (result.empty()) return "ERROR: Unknown INFO section '" + section + "'";
+    return result;
+}
+
+// Accepts plain numbers and memory units (100kb, 64mb, 1gb)
+static bool parseConfigNumber(const std::string& text, long long& value) {
+    try {
+        size_t used = 0;
+        value = std::stoll(text, &used);
+        std::string unit = text.substr(used);
+        std::transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
+        long long multiplier = 1;
+        if (unit == "kb" || unit == "k") multiplier = 1024LL;
+        else if (unit == "mb" || unit == "m") multiplier = 1024LL * 1024;
+        else if (unit == "gb" || unit == "g") multiplier = 1024LL * 1024 * 1024;
+        else if (!unit.empty()) return false;
+        if (value > LLONG_MAX / multiplier || value < LLONG_MIN / multiplier) return false;
+        value *= multiplier;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// CONFIG GET patterns: exact name, "*", or a prefix ending in '*'
+static bool configMatches(const std::string& pattern, const std::string& name) {
+    if (!pattern.empty() && pattern.back() == '*') {
+        return name.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0;
+    }
+    return pattern == name;
+}
+
+// Numeric and yes/no parameters that map straight onto an atomic setting; CONFIG SET and GET share this table
+std::vector<RedisServer::ConfigParameter> RedisServer::configParameters() {
+    return {
+        {"slowlog-log-slower-than", &slowLog.slowerThan, false, -1, LLONG_MAX},
+        {"slowlog-max-len", &slowLog.maxLen, false, 0, LLONG_MAX},
+        {"latency-monitor-threshold", &latencyMonitor.thresholdMs, false, 0, LLONG_MAX},
+        {"maxmemory", &dataStore.maxmemory, false, 0, LLONG_MAX},
+        {"maxmemory-samples", &dataStore.maxmemorySamples, false, 1, 64},   // sampled under the DataStore lock
+        {"tracking-table-max-keys", &tracking.maxKeys, false, 0, LLONG_MAX},
+        {"lazyfree-lazy-expire", &dataStore.lazyfreeLazyExpire, true, 0, 1},
+        {"lazyfree-lazy-eviction", &dataStore.lazyfreeLazyEviction, true, 0, 1},
+        {"lazyfree-lazy-user-del", &dataStore.lazyfreeLazyUserDel, true, 0, 1},
+        {"replica-lazy-flush", &replicaLazyFlush, true, 0, 1},
+        {"repl-output-buffer-limit", &replOutputBufferLimit, false, 0, LLONG_MAX},
+    };
+}
+
+std::string RedisServer::configSet(const std::string& name, const std::string& value) {
+    std::string parameter = name;
+    std::transform(parameter.begin(), parameter.end(), parameter.begin(), ::tolower);
+    
+    if (parameter == "maxmemory-policy") {
+        std::string policy = value;
+        std::transform(policy.begin(), policy.end(), policy.begin(), ::tolower);
+        if (!dataStore.setMaxmemoryPolicy(policy)) {
+            return "ERROR: Invalid argument '" + value + "' for CONFIG SET 'maxmemory-policy'";
+        }
+        return "OK";
+    }
+    
+    if (parameter == "notify-keyspace-events") {
+        if (!dataStore.setNotifyKeyspaceEvents(value)) {
+            return "ERROR: Invalid argument '" + value + "' for CONFIG SET 'notify-keyspace-events'";
+        }
+        return "OK";
+    }
+    
+    if (parameter == "io-backend") {
+        if (running) return "ERROR: 'io-backend' can only be set at startup";
+        if (value != "threads" && value != "epoll" && value != "uring") {
+            return "ERROR: Invalid argument '" + value + "' for CONFIG SET 'io-backend' (threads, epoll or uring)";
+        }
+        ioBackend = value;
+        return "OK";
+    }
+    
+    for (const auto& p : configParameters()) {
+        if (parameter != p.name) continue;
+        long long number;
+        std::string flag = value;
+        std::transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+        if (p.boolean && (flag == "yes" || flag == "no")) {
+            number = flag == "yes";
+        } else if (p.boolean || !parseConfigNumber(value, number)) {
+            return "ERROR: Invalid argument '" + value + "' for CONFIG SET '" + parameter + "'";
+        }
+        if (number < p.min || number > p.max) {
+            return "ERROR: Invalid argument '" + value + "' for CONFIG SET '" + parameter + "' - argument must be between " +
+                   std::to_string(p.min) + " and " + std::to_string(p.max) + " inclusive";
+        }
+        *p.value = number;
+        return "OK";
+    }
+    return "ERROR: Unsupported CONFIG parameter '" + parameter + "'";
+}
+
+// CONFIG GET pattern | CONFIG SET parameter value | CONFIG RESETSTAT
+std::string RedisServer::configCommand(std::stringstream& ss) {
+    std::string subcommand, parameter, value;
+    ss >> subcommand >> parameter >> value;
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    std::transform(parameter.begin(), parameter.end(), parameter.begin(), ::tolower);
+    
+    if (subcommand == "GET") {
+        std::string result;
+        for (const auto& p : configParameters()) {
+            if (configMatches(parameter, p.name)) {
+                long long number = p.value->load();
+                result += std::string(p.name) + " " + (p.boolean ? (number ? "yes" : "no") : std::to_string(number)) + "\n";
+            }
+        }
+        if (configMatches(parameter, "maxmemory-policy")) {
+            result += "maxmemory-policy " + dataStore.maxmemoryPolicyName() + "\n";
+        }
+        if (configMatches(parameter, "notify-keyspace-events")) {
+            result += "notify-keyspace-events " + dataStore.notifyKeyspaceEventsString() + "\n";
+        }
+        if (configMatches(parameter, "io-backend")) {
+            result += "io-backend " + ioBackend + "\n";
+        }
+        if (result.empty()) return "(empty)";
+        result.pop_back();
+        return result;
+    }
+    else if (subcommand == "SET") {
+        return configSet(parameter, value);
+    }
+    else if (subcommand == "RESETSTAT") {
+        commandStats.reset();
+        return "OK";
+    }
+    return "ERROR: usage CONFIG GET pattern | CONFIG SET parameter value | CONFIG RESETSTAT";
+}
+
+// SLOWLOG GET [count] | SLOWLOG LEN | SLOWLOG RESET
+std::string RedisServer::slowlogCommand(std::stringstream& ss) {
+    std::string subcommand;
+    long long count = 10;
+    ss >> subcommand;
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    
+    if (subcommand == "GET") {
+        ss >> count;
+        return slowLog.get(count);
+    }
+    else if (subcommand == "LEN") {
+        return std::to_string(slowLog.len());
+    }
+    else if (subcommand == "RESET") {
+        slowLog.reset();
+        return "OK";
+    }
+    return "ERROR: usage SLOWLOG GET [count] | SLOWLOG LEN | SLOWLOG RESET";
+}
+
+// LATENCY LATEST | LATENCY HISTORY event | LATENCY RESET [event]
+std::string RedisServer::latencyCommand(std::stringstream& ss) {
+    std::string subcommand, event;
+    ss >> subcommand >> event;
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    
+    if (subcommand == "LATEST") {
+        return latencyMonitor.latest();
+    }
+    else if (subcommand == "HISTORY") {
+        return latencyMonitor.history(event);
+    }
+    else if (subcommand == "RESET") {
+        return std::to_string(latencyMonitor.reset(event));
+    }
+    return "ERROR: usage LATENCY LATEST | LATENCY HISTORY event | LATENCY RESET [event]";
+}
+
+// Applies maxmemory before a write; evicted keys are deleted on replicas too
+bool RedisServer::evictIfNeeded() {
+    if (dataStore.maxmemory <= 0 || isReplica) return true;
+    
+    std::vector<std::string> evicted;
+    bool ok = dataStore.freeMemoryIfNeeded(&evicted);
+    for (const auto& key : evicted) propagate("DEL " + key);
+    return ok;
+}
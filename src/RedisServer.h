@@ -3,31 +3,152 @@
 
 #include "DataStore.h"
 #include "PubSub.h"
-#include <winsock2.h>
+#include "Replication.h"
+#include "Cluster.h"
+#include "Stats.h"
+#include "Tracking.h"
+#include "EventLoop.h"
+#include "Platform.h"
 #include <string>
 #include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <condition_variable>
 
-#pragma comment(lib, "ws2_32.lib")
+// Per-connection state (MULTI queue, WATCHed key versions, subscriptions)
+struct ClientContext {
+    bool inMulti = false;
+    bool multiError = false;
+    std::vector<std::string> queued;
+    std::unordered_map<std::string, unsigned long long> watched;
+    bool isMaster = false;      // replication link from our primary, exempt from READONLY
+    int replicaPort = 0;        // set by REPLCONF listening-port
+    bool asking = false;        // ASKING applies to the next command only
+    int pubsubId = 0;           // PubSub client id once the connection subscribes
+    bool tracking = false;      // CLIENT TRACKING ON, invalidations arrive via pubsubId
+};
+
+// Bytes received but not yet answered, for connections served by the event loop
+struct LoopClient {
+    ClientContext ctx;
+    std::string pending;
+    unsigned long long serial = 0;  // tells a reused fd apart when a blocked command completes
+    bool blocked = false;           // a command runs on a worker thread; further input waits in pending
+};
 
-class RedisServer {
+class RedisServer : private EventLoop::Handler {
 private:
     DataStore dataStore;
     PubSub pubSub;
+    Tracking tracking;
     std::atomic<bool> running;
     int port;
     SOCKET serverSocket;
+    
+    // Replication, primary side: stream backlog and attached replicas
+    ReplicationBacklog backlog;
+    std::string replId;
+    std::string replId2;          // previous primary's id, still valid for PSYNC after failover
+    long long secondReplOffset;
+    std::unordered_map<int, ReplicaLink> replicaLinks;
+    std::vector<ReplicaInfo> replicas;
+    int nextReplicaId;
+    SimpleMutex replMtx;
+    std::condition_variable_any replWake;       // replica threads wait here for new output
+    std::atomic<long long> replOutputBufferLimit;   // bytes a replica may fall behind before it is dropped, 0 = no limit
+    
+    // Replication, replica side
+    std::atomic<bool> isReplica;
+    std::string masterHost;
+    int masterPort;
+    std::atomic<int> replLinkGeneration;
+    std::atomic<bool> masterLinkUp;
+    std::atomic<time_t> masterLastIo;
+    std::atomic<long long> replicaLazyFlush;   // drop the old dataset on the lazy-free thread before a full sync
+    
+    // Cluster mode: slot table and bus, null when running standalone
+    std::unique_ptr<Cluster> cluster;
+    
+    // Instrumentation: INFO commandstats, SLOWLOG, LATENCY
+    CommandStats commandStats;
+    SlowLog slowLog;
+    LatencyMonitor latencyMonitor;
+    
+    // Network backend: "threads" (one blocking thread per client), "epoll" or "uring"
+    std::string ioBackend;
+    std::unique_ptr<EventLoop> eventLoop;
+    std::unordered_map<int, LoopClient> loopClients;   // event loop thread only
+    unsigned long long nextLoopSerial;                 // event loop thread only
+    
+    // Replies of commands that waited on the network (MIGRATE, CLUSTER MEET) off the loop
+    // thread; onTick hands them back to their connection
+    struct BlockedReply {
+        int fd;
+        unsigned long long serial;
+        std::string response;
+        ClientContext ctx;
+    };
+    std::vector<BlockedReply> blockedReplies;
+    SimpleMutex blockedMtx;
 
     void handleClient(SOCKET clientSocket);
-    std::string processCommand(const std::string& command);
+    bool processInput(std::string& pending, ClientContext& ctx, std::string& responses, std::string& psync,
+                      std::string* blocking = nullptr);
+    void startReplicaLink(SOCKET clientSocket, const std::string& psync, ClientContext& ctx);
+    void serveLoopClient(int fd, LoopClient& client);
+    void onAccept(int fd) override;
+    void onData(int fd, const char* data, size_t len) override;
+    void onClose(int fd) override;
+    void onTick() override;
+    void onIteration(uint64_t usec) override;
+    std::string processCommand(const std::string& command, ClientContext& ctx);
+    std::string executeCommand(const std::string& command);
+    std::string execTransaction(ClientContext& ctx);
+    void unwatchAll(ClientContext& ctx);
+    void releaseClient(ClientContext& ctx);
+    void trackRead(const std::string& command, ClientContext& ctx);
+    std::string clientCommand(std::stringstream& ss, ClientContext& ctx);
+    
+    void propagate(const std::string& command);
+    void dropReplicas();
+    void syncReplica(SOCKET clientSocket, const std::string& requestedId, long long requestedOffset, ClientContext& ctx);
+    std::string replicaOf(const std::string& host, const std::string& portArg);
+    void replicationLoop(int generation);
+    std::string replicationInfo();
+    
+    std::string clusterCommand(std::stringstream& ss);
+    std::string migrateKey(const std::string& host, const std::string& portArg, const std::string& key);
+    void deliverMessages(SOCKET clientSocket, ClientContext& ctx);
+    void flushKeyspaceEvents();
+    
+    struct ConfigParameter {
+        const char* name;
+        std::atomic<long long>* value;
+        bool boolean;       // yes/no instead of a number
+        long long min;      // CONFIG SET refuses values outside [min, max]
+        long long max;
+    };
+    std::vector<ConfigParameter> configParameters();
+    
+    std::string infoCommand(const std::string& section);
+    std::string configCommand(std::stringstream& ss);
+    bool evictIfNeeded();
+    std::string slowlogCommand(std::stringstream& ss);
+    std::string latencyCommand(std::stringstream& ss);
     void startConsoleUI();
 
 public:
-    RedisServer(int port = 6379);
+    RedisServer(int port = 6379, bool clusterEnabled = false);
     ~RedisServer();
     
     bool start();
     void stop();
     void run();
+    
+    // Runs one command as the given connection would (console, network and in-process callers)
+    std::string call(const std::string& command, ClientContext& ctx);
+    std::string configSet(const std::string& name, const std::string& value);
 };
 
 #endif
\ No newline at end of file
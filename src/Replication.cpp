@@ -0,0 +1,52 @@
+#include "Replication.h"
+#include <algorithm>
+#include <random>
+
+ReplicationBacklog::ReplicationBacklog(size_t size) : buffer(size), head(0), histlen(0), masterOffset(0) {}
+
+void ReplicationBacklog::feed(const std::string& data) {
+    masterOffset += data.size();
+    
+    const char* p = data.data();
+    size_t len = data.size();
+    while (len > 0) {
+        size_t chunk = std::min(len, buffer.size() - head);
+        std::copy(p, p + chunk, buffer.begin() + head);
+        head = (head + chunk) % buffer.size();
+        histlen = std::min(histlen + chunk, buffer.size());
+        p += chunk;
+        len -= chunk;
+    }
+}
+
+bool ReplicationBacklog::readFrom(long long offset, std::string& out) const {
+    if (offset < firstOffset() || offset > masterOffset) return false;
+    
+    size_t len = masterOffset - offset;
+    size_t start = (head + buffer.size() - len) % buffer.size();
+    out.clear();
+    out.reserve(len);
+    while (len > 0) {
+        size_t chunk = std::min(len, buffer.size() - start);
+        out.append(buffer.data() + start, chunk);
+        start = (start + chunk) % buffer.size();
+        len -= chunk;
+    }
+    return true;
+}
+
+void ReplicationBacklog::reset(long long offset) {
+    head = 0;
+    histlen = 0;
+    masterOffset = offset;
+}
+
+std::string generateReplId() {
+    static const char hex[] = "0123456789abcdef";
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    
+    std::string id(40, '0');
+    for (char& c : id) c = hex[gen() % 16];
+    return id;
+}
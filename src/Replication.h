@@ -0,0 +1,47 @@
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include "Platform.h"
+#include <string>
+#include <vector>
+#include <ctime>
+
+// Ring buffer holding the tail of the replication stream, so a replica that
+// reconnects can continue from its last offset instead of a full resync
+class ReplicationBacklog {
+private:
+    std::vector<char> buffer;
+    size_t head;           // next write position in buffer
+    size_t histlen;        // valid bytes currently held
+    long long masterOffset; // total bytes ever fed into the stream
+
+public:
+    ReplicationBacklog(size_t size = 1024 * 1024);
+    
+    void feed(const std::string& data);
+    bool readFrom(long long offset, std::string& out) const;
+    void reset(long long offset);
+    
+    long long offset() const { return masterOffset; }
+    long long firstOffset() const { return masterOffset - (long long)histlen; }
+    size_t size() const { return buffer.size(); }
+};
+
+// Replica attached to this server, as seen from the primary side
+struct ReplicaInfo {
+    int id;
+    std::string address;
+    long long ackOffset;
+    time_t lastAck;
+};
+
+// Write side of one replica link: propagate() only appends to output, the replica's
+// own thread writes it to the non-blocking socket
+struct ReplicaLink {
+    SOCKET sock;
+    std::string output;
+};
+
+std::string generateReplId();
+
+#endif
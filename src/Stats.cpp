@@ -0,0 +1,208 @@
+#include "Stats.h"
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <cctype>
+
+struct CommandStats::LocalShard {
+    Registry* owner;
+    std::weak_ptr<Registry> registry;
+    std::shared_ptr<Shard> shard;
+
+    ~LocalShard() {
+        std::shared_ptr<Registry> live = registry.lock();
+        if (!live) return;
+
+        SimpleLockGuard lock(live->mtx);
+        {
+            SimpleLockGuard retiredLock(live->retired.mtx);
+            SimpleLockGuard shardLock(shard->mtx);
+            mergeInto(live->retired.commands, shard->commands);
+        }
+        for (auto it = live->shards.begin(); it != live->shards.end(); ++it) {
+            if (*it == shard) {
+                live->shards.erase(it);
+                break;
+            }
+        }
+    }
+};
+
+CommandStats::Shard& CommandStats::localShard() {
+    // deque: handles must never be copied or moved, their destructor retires the shard
+    static thread_local std::deque<LocalShard> locals;
+    for (auto& local : locals) {
+        if (local.owner == registry.get() && !local.registry.expired()) return *local.shard;
+    }
+
+    std::shared_ptr<Shard> shard = std::make_shared<Shard>();
+    {
+        SimpleLockGuard lock(registry->mtx);
+        registry->shards.push_back(shard);
+    }
+    locals.emplace_back();
+    LocalShard& local = locals.back();
+    local.owner = registry.get();
+    local.registry = registry;
+    local.shard = shard;
+    return *shard;
+}
+
+void CommandStats::mergeInto(std::unordered_map<std::string, Counter>& target, const std::unordered_map<std::string, Counter>& source) {
+    for (const auto& pair : source) {
+        Counter& counter = target[pair.first];
+        counter.calls += pair.second.calls;
+        counter.usec += pair.second.usec;
+        counter.histogram.merge(pair.second.histogram);
+    }
+}
+
+void CommandStats::record(const std::string& command, uint64_t usec) {
+    Shard& shard = localShard();
+    SimpleLockGuard lock(shard.mtx);
+
+    Counter& counter = shard.commands[command];
+    counter.calls++;
+    counter.usec += usec;
+    counter.histogram.record(usec);
+}
+
+std::string CommandStats::info() {
+    std::unordered_map<std::string, Counter> merged;
+    {
+        SimpleLockGuard lock(registry->mtx);
+        {
+            SimpleLockGuard retiredLock(registry->retired.mtx);
+            mergeInto(merged, registry->retired.commands);
+        }
+        for (const auto& shard : registry->shards) {
+            SimpleLockGuard shardLock(shard->mtx);
+            mergeInto(merged, shard->commands);
+        }
+    }
+
+    std::map<std::string, const Counter*> sorted;
+    for (const auto& pair : merged) sorted[pair.first] = &pair.second;
+
+    std::stringstream ss;
+    ss << "Command Stats:\n";
+    for (const auto& pair : sorted) {
+        const Counter& counter = *pair.second;
+        std::string name = pair.first;
+        for (char& c : name) c = (char)tolower((unsigned char)c);
+        ss << "cmdstat_" << name << ": calls=" << counter.calls
+           << " usec=" << counter.usec
+           << " usec_per_call=" << std::fixed << std::setprecision(2) << (double)counter.usec / counter.calls
+           << " p50=" << counter.histogram.valueAtPercentile(50)
+           << " p99=" << counter.histogram.valueAtPercentile(99)
+           << " p999=" << counter.histogram.valueAtPercentile(99.9)
+           << " max=" << counter.histogram.max() << "\n";
+    }
+    return ss.str();
+}
+
+void CommandStats::reset() {
+    SimpleLockGuard lock(registry->mtx);
+    {
+        SimpleLockGuard retiredLock(registry->retired.mtx);
+        registry->retired.commands.clear();
+    }
+    for (const auto& shard : registry->shards) {
+        SimpleLockGuard shardLock(shard->mtx);
+        shard->commands.clear();
+    }
+}
+
+void SlowLog::record(const std::string& command, uint64_t usec) {
+    long long threshold = slowerThan;
+    if (threshold < 0 || (long long)usec < threshold) return;
+
+    SimpleLockGuard lock(mtx);
+    // Long arguments are cut so one huge value cannot bloat the log
+    std::string text = command.size() > 128 ? command.substr(0, 128) + "... (" + std::to_string(command.size()) + " bytes)" : command;
+    entries.push_front({nextId++, time(nullptr), usec, text});
+    while ((long long)entries.size() > maxLen && !entries.empty()) entries.pop_back();
+}
+
+std::string SlowLog::get(long long count) {
+    SimpleLockGuard lock(mtx);
+    std::stringstream ss;
+    long long shown = 0;
+    for (const auto& entry : entries) {
+        if (count >= 0 && shown >= count) break;
+        ss << entry.id << ") time=" << entry.timestamp << " usec=" << entry.usec << " " << entry.command << "\n";
+        shown++;
+    }
+    std::string result = ss.str();
+    if (result.empty()) return "(empty)";
+    result.pop_back();
+    return result;
+}
+
+size_t SlowLog::len() {
+    SimpleLockGuard lock(mtx);
+    return entries.size();
+}
+
+void SlowLog::reset() {
+    SimpleLockGuard lock(mtx);
+    entries.clear();
+}
+
+void LatencyMonitor::record(const char* event, uint64_t usec) {
+    long long threshold = thresholdMs;
+    uint64_t ms = usec / 1000;
+    if (threshold <= 0 || (long long)ms < threshold) return;
+
+    SimpleLockGuard lock(mtx);
+    Event& entry = events[event];
+    time_t now = time(nullptr);
+    entry.latestTime = now;
+    entry.latestMs = ms;
+    if (ms > entry.maxMs) entry.maxMs = ms;
+
+    // One sample per second, keeping the worst spike of that second
+    if (!entry.history.empty() && entry.history.back().time == now) {
+        if (ms > entry.history.back().ms) entry.history.back().ms = ms;
+    } else {
+        entry.history.push_back({now, ms});
+        if (entry.history.size() > HISTORY_LEN) entry.history.pop_front();
+    }
+}
+
+std::string LatencyMonitor::latest() {
+    SimpleLockGuard lock(mtx);
+    std::stringstream ss;
+    for (const auto& pair : events) {
+        ss << pair.first << ": time=" << pair.second.latestTime << " latest=" << pair.second.latestMs
+           << "ms max=" << pair.second.maxMs << "ms\n";
+    }
+    std::string result = ss.str();
+    if (result.empty()) return "(empty)";
+    result.pop_back();
+    return result;
+}
+
+std::string LatencyMonitor::history(const std::string& event) {
+    SimpleLockGuard lock(mtx);
+    auto it = events.find(event);
+    if (it == events.end()) return "(empty)";
+
+    std::stringstream ss;
+    for (const auto& sample : it->second.history) {
+        ss << sample.time << " " << sample.ms << "ms\n";
+    }
+    std::string result = ss.str();
+    result.pop_back();
+    return result;
+}
+
+int LatencyMonitor::reset(const std::string& event) {
+    SimpleLockGuard lock(mtx);
+    if (event.empty()) {
+        int count = events.size();
+        events.clear();
+        return count;
+    }
+    return events.erase(event);
+}
@@ -0,0 +1,102 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "DataStore.h"
+#include "Histogram.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+// Per-command call counts, total microseconds and latency histograms (INFO commandstats).
+// Each thread records into its own shard; shards are only merged when someone reads.
+class CommandStats {
+private:
+    struct Counter {
+        uint64_t calls = 0;
+        uint64_t usec = 0;
+        LatencyHistogram histogram;
+    };
+    struct Shard {
+        SimpleMutex mtx;    // uncontended except while a reader merges
+        std::unordered_map<std::string, Counter> commands;
+    };
+    struct Registry {
+        SimpleMutex mtx;
+        std::vector<std::shared_ptr<Shard>> shards;
+        Shard retired;      // totals of threads that have exited
+    };
+    struct LocalShard;      // thread_local handle, folds its shard into retired on thread exit
+
+    std::shared_ptr<Registry> registry;
+
+    Shard& localShard();
+    static void mergeInto(std::unordered_map<std::string, Counter>& target, const std::unordered_map<std::string, Counter>& source);
+
+public:
+    CommandStats() : registry(std::make_shared<Registry>()) {}
+
+    void record(const std::string& command, uint64_t usec);
+    std::string info();
+    void reset();
+};
+
+// Commands slower than a threshold, newest first (SLOWLOG GET/LEN/RESET)
+class SlowLog {
+private:
+    struct Entry {
+        long long id;
+        time_t timestamp;
+        uint64_t usec;
+        std::string command;
+    };
+    std::deque<Entry> entries;
+    long long nextId;
+    SimpleMutex mtx;
+
+public:
+    std::atomic<long long> slowerThan;   // microseconds, negative disables
+    std::atomic<long long> maxLen;
+
+    SlowLog() : nextId(0), slowerThan(10000), maxLen(128) {}
+
+    void record(const std::string& command, uint64_t usec);
+    std::string get(long long count);
+    size_t len();
+    void reset();
+};
+
+// Latency spikes per event class ("command", "eventloop") above a threshold (LATENCY LATEST/HISTORY/RESET)
+class LatencyMonitor {
+private:
+    struct Sample {
+        time_t time;
+        uint64_t ms;
+    };
+    struct Event {
+        time_t latestTime = 0;
+        uint64_t latestMs = 0;
+        uint64_t maxMs = 0;
+        std::deque<Sample> history;
+    };
+    static const size_t HISTORY_LEN = 160;
+
+    std::unordered_map<std::string, Event> events;
+    SimpleMutex mtx;
+
+public:
+    std::atomic<long long> thresholdMs;   // 0 disables monitoring
+
+    LatencyMonitor() : thresholdMs(0) {}
+
+    void record(const char* event, uint64_t usec);
+    std::string latest();
+    std::string history(const std::string& event);
+    int reset(const std::string& event);
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "Tracking.h"
+#include <sstream>
+
+const char* Tracking::CHANNEL = "__redis__:invalidate";
+
+void Tracking::send(int clientId, const std::string& key) {
+    pubSub.push(clientId, CHANNEL, key.empty() ? "(nil)" : key);
+}
+
+void Tracking::sendToBitmap(const std::vector<uint64_t>& bitmap, const std::string& key) {
+    for (size_t word = 0; word < bitmap.size(); ++word) {
+        uint64_t bits = bitmap[word];
+        while (bits) {
+            int bit = (int)(word * 64) + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (bit < (int)clientByBit.size() && clientByBit[bit] != 0) send(clientByBit[bit], key);
+        }
+    }
+}
+
+void Tracking::enable(int clientId, bool bcast, const std::vector<std::string>& prefixes) {
+    SimpleLockGuard lock(mtx);
+    auto it = clients.find(clientId);
+    if (it == clients.end()) {
+        int bit = 0;
+        while (bit < (int)clientByBit.size() && clientByBit[bit] != 0) bit++;
+        if (bit == (int)clientByBit.size()) clientByBit.push_back(0);
+        clientByBit[bit] = clientId;
+        it = clients.emplace(clientId, TrackedClient{bit, false, {}}).first;
+        trackingClients++;
+    }
+    if (it->second.bcast) bcastClients--;
+    it->second.bcast = bcast;
+    it->second.prefixes = prefixes;
+    if (bcast) bcastClients++;
+}
+
+// The client's bit is freed but not scrubbed from the table: whoever reuses it may get
+// a few stale invalidations, which only cost a cache miss
+void Tracking::disable(int clientId) {
+    SimpleLockGuard lock(mtx);
+    auto it = clients.find(clientId);
+    if (it == clients.end()) return;
+    if (it->second.bcast) bcastClients--;
+    clientByBit[it->second.bit] = 0;
+    clients.erase(it);
+    trackingClients--;
+    if (clients.empty()) table.clear();
+}
+
+void Tracking::remember(int clientId, const std::string& key) {
+    SimpleLockGuard lock(mtx);
+    auto it = clients.find(clientId);
+    if (it == clients.end() || it->second.bcast) return;
+
+    int bit = it->second.bit;
+    auto entry = table.find(key);
+    if (entry == table.end()) {
+        // Make room first: an arbitrary entry goes, and its readers are told to drop the key
+        long long limit = maxKeys;
+        while (limit > 0 && (long long)table.size() >= limit) {
+            auto victim = table.begin();
+            sendToBitmap(victim->second, victim->first);
+            table.erase(victim);
+        }
+        entry = table.emplace(key, std::vector<uint64_t>()).first;
+    }
+    std::vector<uint64_t>& bitmap = entry->second;
+    if (bitmap.size() <= (size_t)bit / 64) bitmap.resize(bit / 64 + 1, 0);
+    bitmap[bit / 64] |= 1ULL << (bit % 64);
+}
+
+void Tracking::invalidate(const std::string& key) {
+    if (trackingClients == 0) return;
+    SimpleLockGuard lock(mtx);
+
+    if (key.empty()) {
+        table.clear();
+        for (const auto& pair : clients) send(pair.first, key);
+        return;
+    }
+
+    auto entry = table.find(key);
+    if (entry != table.end()) {
+        sendToBitmap(entry->second, key);
+        table.erase(entry);
+    }
+
+    if (bcastClients == 0) return;
+    for (const auto& pair : clients) {
+        if (!pair.second.bcast) continue;
+        bool matches = pair.second.prefixes.empty();
+        for (const auto& prefix : pair.second.prefixes) {
+            if (key.compare(0, prefix.size(), prefix) == 0) {
+                matches = true;
+                break;
+            }
+        }
+        if (matches) send(pair.first, key);
+    }
+}
+
+std::string Tracking::info() {
+    SimpleLockGuard lock(mtx);
+    std::stringstream ss;
+    ss << "Tracking Clients: " << clients.size() << "\n";
+    ss << "Tracking Keys: " << table.size() << "\n";
+    return ss.str();
+}
@@ -0,0 +1,53 @@
+#ifndef TRACKING_H
+#define TRACKING_H
+
+#include "DataStore.h"
+#include "PubSub.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+
+// Server-assisted client-side caching (CLIENT TRACKING). Invalidations are queued on the
+// client's PubSub connection as "[__redis__:invalidate] key"; "(nil)" means every key (FLUSHALL).
+//
+// Default mode remembers reads in a key -> client-bitmap table: each tracking client owns
+// one bit, a key costs its name plus a few words of bitmap, and an entry is dropped once its
+// invalidation has been sent (the client has to read the key again anyway). At
+// tracking-table-max-keys, remembering a new key first evicts another one, invalidating it early.
+// BCAST mode keeps no per-key state: every change to a key under a registered prefix is sent.
+class Tracking {
+private:
+    struct TrackedClient {
+        int bit;
+        bool bcast;
+        std::vector<std::string> prefixes;   // BCAST only, empty = every key
+    };
+
+    PubSub& pubSub;
+    std::unordered_map<int, TrackedClient> clients;      // by PubSub client id
+    std::vector<int> clientByBit;                        // bit -> PubSub client id, 0 = free
+    std::unordered_map<std::string, std::vector<uint64_t>> table;
+    int bcastClients;
+    std::atomic<int> trackingClients;                    // lets invalidate() skip the lock when unused
+    SimpleMutex mtx;
+
+    void send(int clientId, const std::string& key);
+    void sendToBitmap(const std::vector<uint64_t>& bitmap, const std::string& key);
+
+public:
+    static const char* CHANNEL;
+
+    std::atomic<long long> maxKeys;      // tracking-table-max-keys, 0 = unlimited
+
+    Tracking(PubSub& pubSub) : pubSub(pubSub), bcastClients(0), trackingClients(0), maxKeys(1000000) {}
+
+    void enable(int clientId, bool bcast, const std::vector<std::string>& prefixes);
+    void disable(int clientId);
+    void remember(int clientId, const std::string& key);
+    void invalidate(const std::string& key);    // empty key: the whole dataset changed
+    std::string info();
+};
+
+#endif
@@ -1,11 +1,34 @@
 #include "RedisServer.h"
 #include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
 
-int main() {
+int main(int argc, char* argv[]) {
     std::cout << "=== Redis-like Server ===" << std::endl;
     std::cout << "Building with GCC " << __VERSION__ << std::endl;
     
-    RedisServer server(6379);
+    // Usage: redis-server [port] [--cluster] [--<config-parameter> value ...]
+    // A port argument lets several servers (replicas, cluster nodes) run on one machine
+    int port = 6379;
+    bool clusterEnabled = false;
+    std::vector<std::pair<std::string, std::string>> config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--cluster") clusterEnabled = true;
+        else if (arg.compare(0, 2, "--") == 0 && i + 1 < argc) config.push_back({arg.substr(2), argv[++i]});
+        else port = std::atoi(argv[i]);
+    }
+    RedisServer server(port, clusterEnabled);
+    
+    // e.g. --maxmemory 256mb --maxmemory-policy allkeys-lru --io-backend uring
+    for (const auto& option : config) {
+        std::string result = server.configSet(option.first, option.second);
+        if (result != "OK") {
+            std::cerr << result << std::endl;
+            return 1;
+        }
+    }
     
     if (!server.start()) {
         std::cerr << "Failed to start server!" << std::endl;
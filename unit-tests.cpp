@@ -0,0 +1,536 @@
+// In-process checks for DataStore, PubSub, Histogram and the command layer, no network involved
+//
+// Build: g++ -O2 -std=c++17 unit-tests.cpp src/RedisServer.cpp src/DataStore.cpp src/LazyFree.cpp src/PubSub.cpp
+//            src/Tracking.cpp src/Replication.cpp src/Cluster.cpp src/Stats.cpp src/EventLoop.cpp src/Platform.cpp
+//            -o unit-tests -lpthread
+// Usage: unit-tests   (exit status 1 if any check fails)
+
+#include "src/RedisServer.h"
+#include "src/DataStore.h"
+#include "src/PubSub.h"
+#include "src/Tracking.h"
+#include "src/Histogram.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <climits>
+
+static int checks = 0;
+static int failures = 0;
+
+static void check(bool ok, const std::string& what, const char* file, int line) {
+    checks++;
+    if (ok) return;
+    failures++;
+    std::cout << file << ":" << line << ": FAILED " << what << std::endl;
+}
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(actual, expected) \
+    check((actual) == (expected), std::string(#actual) + " == " + #expected, __FILE__, __LINE__)
+
+// MULTI queues data commands and PUBLISH, refuses state changes, and EXEC honours WATCH
+static void testTransactions() {
+    RedisServer server(0);
+    ClientContext client, other;
+
+    CHECK_EQ(server.call("MULTI", client), "OK");
+    CHECK_EQ(server.call("SET k 1", client), "QUEUED");
+    CHECK_EQ(server.call("PUBLISH ch hi", client), "QUEUED");
+    CHECK_EQ(server.call("INCR k", client), "QUEUED");
+    CHECK_EQ(server.call("EXEC", client), "1) OK\n2) 0\n3) 2");
+
+    CHECK_EQ(server.call("MULTI", client), "OK");
+    CHECK_EQ(server.call("SUBSCRIBE x", client), "ERROR: Command not allowed inside a transaction");
+    CHECK_EQ(client.pubsubId, 0);
+    CHECK_EQ(server.call("CLIENT TRACKING ON", client), "ERROR: Command not allowed inside a transaction");
+    CHECK_EQ(server.call("SET k 5", client), "QUEUED");
+    CHECK_EQ(server.call("EXEC", client).compare(0, 16, "ERROR: EXECABORT"), 0);
+    CHECK_EQ(server.call("GET k", client), "2");
+
+    CHECK_EQ(server.call("WATCH k", client), "OK");
+    CHECK_EQ(server.call("SET k 3", other), "OK");
+    CHECK_EQ(server.call("MULTI", client), "OK");
+    CHECK_EQ(server.call("SET k 4", client), "QUEUED");
+    CHECK_EQ(server.call("EXEC", client), "(nil)");
+    CHECK_EQ(server.call("GET k", client), "3");
+
+    // ASKING and REPLCONF would act at queue time, not at EXEC
+    RedisServer node(0, true);
+    CHECK_EQ(node.call("MULTI", client), "OK");
+    CHECK_EQ(node.call("ASKING", client), "ERROR: Command not allowed inside a transaction");
+    CHECK(!client.asking);
+    CHECK_EQ(node.call("REPLCONF listening-port 7000", client), "ERROR: Command not allowed inside a transaction");
+    CHECK_EQ(client.replicaPort, 0);
+    CHECK_EQ(node.call("EXEC", client).compare(0, 16, "ERROR: EXECABORT"), 0);
+    CHECK_EQ(node.call("ASKING", client), "OK");
+    CHECK(client.asking);
+
+    DataStore store;
+    unsigned long long version = store.watch("w");
+    store.get("w");
+    CHECK_EQ(store.version("w"), version);
+    store.set("w", "v");
+    CHECK(store.version("w") != version);
+    store.unwatch("w");
+}
+
+// Exact below 128, within the 2% bucket error above, and merge/reset keep the summary consistent
+static void testHistogram() {
+    LatencyHistogram histogram;
+    CHECK_EQ(histogram.valueAtPercentile(50), 0u);
+    for (uint64_t value = 1; value <= 100; ++value) histogram.record(value);
+    CHECK_EQ(histogram.count(), 100u);
+    CHECK_EQ(histogram.min(), 1u);
+    CHECK_EQ(histogram.max(), 100u);
+    CHECK_EQ(histogram.valueAtPercentile(50), 50u);
+    CHECK_EQ(histogram.valueAtPercentile(99), 99u);
+    CHECK_EQ(histogram.valueAtPercentile(100), 100u);
+    CHECK(histogram.mean() > 50.49 && histogram.mean() < 50.51);
+
+    LatencyHistogram large;
+    for (uint64_t value = 1000; value <= 1000000; value += 1000) large.record(value);
+    uint64_t p50 = large.valueAtPercentile(50);
+    uint64_t p999 = large.valueAtPercentile(99.9);
+    CHECK(p50 >= 500000 && p50 <= 510000);
+    CHECK(p999 >= 999000 && p999 <= 1000000);
+
+    histogram.merge(large);
+    CHECK_EQ(histogram.count(), 1100u);
+    CHECK_EQ(histogram.min(), 1u);
+    CHECK_EQ(histogram.max(), 1000000u);
+    histogram.reset();
+    CHECK_EQ(histogram.count(), 0u);
+    CHECK_EQ(histogram.max(), 0u);
+
+    // Values past the last bucket are counted there and reported as the recorded max
+    histogram.record(UINT64_MAX / 2);
+    CHECK_EQ(histogram.valueAtPercentile(50), UINT64_MAX / 2);
+}
+
+// Stats are keyed by the command table; junk names share cmdstat_unknown
+static void testCommandStats() {
+    RedisServer server(0);
+    ClientContext client;
+
+    CHECK_EQ(server.call("MULTI", client), "OK");
+    CHECK_EQ(server.call("FOOBAR 1", client).compare(0, 22, "ERROR: Unknown command"), 0);
+    CHECK_EQ(server.call("EXEC", client).compare(0, 16, "ERROR: EXECABORT"), 0);
+    server.call("BAZQUX", client);
+    server.call("set a 1", client);
+
+    std::string info = server.call("INFO commandstats", client);
+    CHECK(info.find("cmdstat_foobar") == std::string::npos);
+    CHECK(info.find("cmdstat_bazqux") == std::string::npos);
+    CHECK(info.find("cmdstat_unknown: calls=2") != std::string::npos);
+    CHECK(info.find("cmdstat_set: calls=1") != std::string::npos);
+    CHECK(server.call("HELP", client).find(" INCRBYFLOAT,") != std::string::npos);
+}
+
+// One table backs CONFIG SET and GET
+static void testConfig() {
+    RedisServer server(0);
+    ClientContext client;
+
+    CHECK_EQ(server.call("CONFIG SET maxmemory 1mb", client), "OK");
+    CHECK_EQ(server.call("CONFIG GET maxmemory", client), "maxmemory 1048576");
+    CHECK_EQ(server.call("CONFIG SET maxmemory-samples 7", client), "OK");
+    CHECK_EQ(server.call("CONFIG GET maxmemory-samples", client), "maxmemory-samples 7");
+    CHECK_EQ(server.call("CONFIG SET maxmemory lots", client).compare(0, 24, "ERROR: Invalid argument "), 0);
+
+    // Out-of-range values are refused and leave the setting alone
+    CHECK_EQ(server.call("CONFIG SET maxmemory-samples 1000000000", client),
+             "ERROR: Invalid argument '1000000000' for CONFIG SET 'maxmemory-samples' - argument must be between 1 and 64 inclusive");
+    CHECK(server.call("CONFIG SET maxmemory-samples 0", client).rfind("ERROR: Invalid argument", 0) == 0);
+    CHECK_EQ(server.call("CONFIG SET maxmemory-samples 64", client), "OK");
+    CHECK(server.call("CONFIG SET maxmemory -1", client).rfind("ERROR: Invalid argument", 0) == 0);
+    CHECK(server.call("CONFIG SET maxmemory 9000000000gb", client).rfind("ERROR: Invalid argument", 0) == 0);
+    CHECK_EQ(server.call("CONFIG GET maxmemory", client), "maxmemory 1048576");
+    CHECK(server.call("CONFIG SET tracking-table-max-keys -5", client).rfind("ERROR: Invalid argument", 0) == 0);
+    CHECK(server.call("CONFIG SET slowlog-log-slower-than -2", client).rfind("ERROR: Invalid argument", 0) == 0);
+    CHECK_EQ(server.call("CONFIG SET slowlog-log-slower-than -1", client), "OK");
+    CHECK_EQ(server.call("CONFIG SET maxmemory-samples 7", client), "OK");
+    CHECK_EQ(server.call("CONFIG SET no-such-thing 1", client).compare(0, 32, "ERROR: Unsupported CONFIG parame"), 0);
+    CHECK_EQ(server.call("CONFIG SET maxmemory-policy allkeys-lfu", client), "OK");
+    CHECK_EQ(server.call("CONFIG GET maxmemory-policy", client), "maxmemory-policy allkeys-lfu");
+}
+
+// Eviction respects the policy's key set and ordering and gets back under the limit
+static void testEviction() {
+    {
+        DataStore store;
+        for (int i = 0; i < 100; ++i) store.set("key:" + std::to_string(i), std::string(100, 'x'));
+        store.maxmemory = 1000;
+        CHECK(!store.freeMemoryIfNeeded());     // noeviction
+        CHECK_EQ(store.dbsize(), 100);
+    }
+    {
+        // volatile-*: keys without a TTL are never candidates
+        DataStore store;
+        CHECK(store.setMaxmemoryPolicy("volatile-lru"));
+        for (int i = 0; i < 100; ++i) store.set("persistent:" + std::to_string(i), std::string(100, 'x'));
+        for (int i = 0; i < 20; ++i) store.set("volatile:" + std::to_string(i), std::string(100, 'x'), 1000);
+        store.maxmemory = 1;
+        std::vector<std::string> evicted;
+        CHECK(!store.freeMemoryIfNeeded(&evicted));
+        CHECK_EQ(evicted.size(), 20u);
+        for (const auto& key : evicted) CHECK_EQ(key.compare(0, 9, "volatile:"), 0);
+        CHECK_EQ(store.dbsize(), 100);
+    }
+    {
+        // A pooled key that became persistent since it was sampled is no longer a candidate
+        DataStore store;
+        CHECK(store.setMaxmemoryPolicy("volatile-lru"));
+        for (int i = 0; i < 10; ++i) store.set("v" + std::to_string(i), std::string(100, 'x'), 1000);
+        store.maxmemory = 8 * 102;
+        std::vector<std::string> evicted;
+        CHECK(store.freeMemoryIfNeeded(&evicted));
+        CHECK(!evicted.empty());
+        std::vector<std::string> remaining;
+        for (int i = 0; i < 10; ++i) {
+            std::string key = "v" + std::to_string(i);
+            if (!store.exists(key)) continue;
+            remaining.push_back(key);
+            store.set(key, std::string(100, 'x'));
+        }
+        store.maxmemory = 1;
+        evicted.clear();
+        CHECK(!store.freeMemoryIfNeeded(&evicted));
+        CHECK(evicted.empty());
+        for (const auto& key : remaining) CHECK(store.exists(key));
+    }
+    {
+        // volatile-ttl: the pool keeps the soonest-expiring candidates
+        DataStore store;
+        CHECK(store.setMaxmemoryPolicy("volatile-ttl"));
+        for (int i = 0; i < 100; ++i) store.set("soon:" + std::to_string(i), std::string(100, 'x'), 10);
+        for (int i = 0; i < 100; ++i) store.set("late:" + std::to_string(i), std::string(100, 'x'), 100000);
+        store.maxmemory = 150 * 203;     // about 50 of the 200 keys must go
+        std::vector<std::string> evicted;
+        CHECK(store.freeMemoryIfNeeded(&evicted));
+        int soon = 0;
+        for (const auto& key : evicted) soon += key.compare(0, 5, "soon:") == 0;
+        CHECK(!evicted.empty());
+        CHECK(soon * 10 >= (int)evicted.size() * 8);    // sampled, so approximately
+        CHECK(store.info().find("Evicted Keys: " + std::to_string(evicted.size()) + "\n") != std::string::npos);
+    }
+    {
+        // allkeys-lfu: frequently read keys survive
+        DataStore store;
+        CHECK(store.setMaxmemoryPolicy("allkeys-lfu"));
+        for (int i = 0; i < 100; ++i) store.set("cold:" + std::to_string(i), std::string(100, 'x'));
+        for (int i = 0; i < 10; ++i) store.set("hot:" + std::to_string(i), std::string(100, 'x'));
+        for (int round = 0; round < 200; ++round) {
+            for (int i = 0; i < 10; ++i) store.get("hot:" + std::to_string(i));
+        }
+        store.maxmemory = 40 * 160;
+        std::vector<std::string> evicted;
+        CHECK(store.freeMemoryIfNeeded(&evicted));
+        for (const auto& key : evicted) CHECK_EQ(key.compare(0, 5, "cold:"), 0);
+        for (int i = 0; i < 10; ++i) CHECK(store.exists("hot:" + std::to_string(i)));
+    }
+}
+
+static long long infoNumber(const std::string& info, const std::string& field) {
+    size_t pos = info.find(field + ": ");
+    return pos == std::string::npos ? -1 : std::atoll(info.c_str() + pos + field.size() + 2);
+}
+
+// Big values leave the keyspace at once and are freed on the lazy-free thread; small ones inline
+static void testLazyFree() {
+    DataStore store;
+    for (int i = 0; i < 1000; ++i) store.hset("big", "field:" + std::to_string(i), "value");
+    store.set("small", "value");
+
+    CHECK_EQ(store.unlink("big"), 1);
+    CHECK(!store.exists("big"));
+    CHECK_EQ(store.unlink("small"), 1);
+    CHECK_EQ(store.unlink("missing"), 0);
+
+    store.lazyfreeLazyUserDel = 1;
+    for (int i = 0; i < 1000; ++i) store.rpush("list", "value");
+    CHECK_EQ(store.del("list"), 1);
+
+    for (int i = 0; i < 100; ++i) store.set("key:" + std::to_string(i), "value");
+    store.flushall(true);
+    CHECK_EQ(store.dbsize(), 0);
+    CHECK_EQ(infoNumber(store.info(), "Used Memory"), 0);
+
+    // The hash, the list and the seven maps FLUSHALL ASYNC swapped out
+    for (int wait = 0; wait < 200 && infoNumber(store.info(), "Lazyfreed Objects") < 9; ++wait) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CHECK_EQ(infoNumber(store.info(), "Lazyfreed Objects"), 9);
+    CHECK_EQ(infoNumber(store.info(), "Lazyfree Pending Objects"), 0);
+
+    RedisServer server(0);
+    ClientContext client;
+    CHECK_EQ(server.call("CONFIG SET lazyfree-lazy-user-del yes", client), "OK");
+    CHECK_EQ(server.call("CONFIG GET lazyfree-lazy-user-del", client), "lazyfree-lazy-user-del yes");
+    CHECK_EQ(server.call("CONFIG SET lazyfree-lazy-user-del 2", client).compare(0, 24, "ERROR: Invalid argument "), 0);
+    CHECK_EQ(server.call("CONFIG SET maxmemory yes", client).compare(0, 24, "ERROR: Invalid argument "), 0);
+    CHECK_EQ(server.call("SET k v", client), "OK");
+    CHECK_EQ(server.call("FLUSHALL ASYNC", client), "OK");
+    CHECK_EQ(server.call("DBSIZE", client), "0");
+}
+
+// Integers are stored as int64: canonical text only, overflow refused, floats printed in full
+static void testIntegers() {
+    long long value;
+    CHECK(DataStore::parseInteger("-9223372036854775808", value) && value == LLONG_MIN);
+    CHECK(DataStore::parseInteger("9223372036854775807", value) && value == LLONG_MAX);
+    CHECK(!DataStore::parseInteger("9223372036854775808", value));
+    CHECK(!DataStore::parseInteger("0123", value));
+    CHECK(!DataStore::parseInteger("-0", value));
+    CHECK(!DataStore::parseInteger("+1", value));
+    CHECK(!DataStore::parseInteger("", value));
+
+    RedisServer server(0);
+    ClientContext client;
+    CHECK_EQ(server.call("INCR n", client), "1");
+    CHECK_EQ(server.call("INCRBY n 41", client), "42");
+    CHECK_EQ(server.call("DECRBY n 50", client), "-8");
+    CHECK_EQ(server.call("GET n", client), "-8");
+    CHECK_EQ(server.call("GETSET n 0123", client), "-8");
+    CHECK_EQ(server.call("GET n", client), "0123");
+    CHECK_EQ(server.call("INCR n", client), "ERROR: value is not an integer or out of range");
+
+    CHECK_EQ(server.call("SET max 9223372036854775807", client), "OK");
+    CHECK_EQ(server.call("INCR max", client), "ERROR: increment or decrement would overflow");
+    CHECK_EQ(server.call("DECRBY max -9223372036854775808", client), "ERROR: decrement would overflow");
+    CHECK_EQ(server.call("GET max", client), "9223372036854775807");
+
+    CHECK_EQ(server.call("SET f 10.5", client), "OK");
+    CHECK_EQ(server.call("INCRBYFLOAT f 0.1", client), "10.6");
+    CHECK_EQ(server.call("INCRBYFLOAT f -10.6", client), "0");
+    CHECK_EQ(server.call("INCRBYFLOAT f 5.0e3", client), "5000");
+    CHECK_EQ(server.call("INCRBYFLOAT f abc", client), "ERROR: value is not a valid float");
+
+    // Past 1e126 the old 128-byte buffer silently truncated the digits
+    CHECK_EQ(server.call("SET big 1", client), "OK");
+    std::string big = server.call("INCRBYFLOAT big 1e200", client);
+    CHECK_EQ(big.size(), 201u);
+    CHECK_EQ(big.compare(0, 16, "1000000000000000"), 0);
+    CHECK_EQ(server.call("GET big", client), big);
+    std::string huge = server.call("INCRBYFLOAT huge 1e4000", client);
+    CHECK(huge.size() >= 4000 && huge.size() <= 4001);
+    CHECK_EQ(huge.find_first_not_of("0123456789"), std::string::npos);
+}
+
+// Invalidations reach the readers of a key once; the table stays within tracking-table-max-keys
+static void testTracking() {
+    PubSub pubSub;
+    Tracking tracking(pubSub);
+    int reader = pubSub.registerClient();
+    int other = pubSub.registerClient();
+    int bcast = pubSub.registerClient();
+    tracking.enable(reader, false, {});
+    tracking.enable(other, false, {});
+    tracking.enable(bcast, true, {"user:"});
+
+    tracking.remember(reader, "user:1");
+    tracking.remember(other, "user:2");
+    tracking.invalidate("user:1");
+    tracking.invalidate("user:1");
+    CHECK(pubSub.getMessages(reader) == std::vector<std::string>{"[__redis__:invalidate] user:1"});
+    CHECK(pubSub.getMessages(other).empty());
+    CHECK_EQ(pubSub.getMessages(bcast).size(), 2u);
+    tracking.invalidate("post:1");
+    CHECK(pubSub.getMessages(bcast).empty());
+
+    tracking.invalidate("");
+    CHECK(pubSub.getMessages(reader) == std::vector<std::string>{"[__redis__:invalidate] (nil)"});
+    CHECK_EQ(pubSub.getMessages(other).size(), 1u);
+    pubSub.getMessages(bcast);
+
+    tracking.maxKeys = 100;
+    for (int i = 0; i < 1000; ++i) tracking.remember(reader, "key:" + std::to_string(i));
+    CHECK(tracking.info().find("Tracking Keys: 100\n") != std::string::npos);
+    CHECK_EQ(pubSub.getMessages(reader).size(), 900u);
+
+    tracking.disable(reader);
+    tracking.disable(other);
+    tracking.disable(bcast);
+    CHECK(tracking.info().find("Tracking Keys: 0\n") != std::string::npos);
+
+    RedisServer server(0);
+    ClientContext client;
+    CHECK_EQ(server.call("CONFIG SET tracking-table-max-keys 10", client), "OK");
+    CHECK_EQ(server.call("CONFIG GET tracking-table-max-keys", client), "tracking-table-max-keys 10");
+}
+
+static std::string eventList(const std::vector<KeyspaceEvent>& events) {
+    std::string result;
+    for (const auto& event : events) result += std::string(event.event) + ":" + event.key + " ";
+    return result;
+}
+
+// Events are queued per class and only while a keyspace channel has a subscriber
+static void testKeyspaceEvents() {
+    PubSub pubSub;
+    DataStore store;
+    store.setNotifyGate(&pubSub.keyspaceSubscriptions);
+
+    CHECK(!store.setNotifyKeyspaceEvents("KQ"));
+    CHECK(store.setNotifyKeyspaceEvents("KEA"));
+    CHECK_EQ(store.notifyKeyspaceEventsString(), "AKE");
+    CHECK(store.setNotifyKeyspaceEvents("El$"));
+    CHECK_EQ(store.notifyKeyspaceEventsString(), "$lE");
+
+    // Nobody subscribed: nothing is queued
+    store.set("a", "1");
+    CHECK(store.takeKeyspaceEvents().empty());
+
+    int subscriber = pubSub.registerClient();
+    pubSub.subscribe(subscriber, "news");
+    CHECK_EQ(pubSub.keyspaceSubscriptions.load(), 0);
+    pubSub.subscribe(subscriber, "__keyevent@0__:set");
+    pubSub.subscribe(subscriber, "__keyevent@0__:set");
+    CHECK_EQ(pubSub.keyspaceSubscriptions.load(), 1);
+
+    store.set("a", "2");
+    store.incr("n");
+    store.lpush("l", "x");
+    store.hset("h", "f", "v");     // h not enabled
+    store.del("a");                // g not enabled
+    CHECK_EQ(eventList(store.takeKeyspaceEvents()), "set:a incrby:n lpush:l ");
+    CHECK(store.takeKeyspaceEvents().empty());
+
+    CHECK(store.setNotifyKeyspaceEvents("KEA"));
+    store.set("t", "v", 100);
+    store.expire("t", 1);
+    store.sadd("s", "m");
+    store.sadd("s", "m");
+    store.del("t");
+    store.del("t");
+    store.unlink("s");
+    CHECK_EQ(eventList(store.takeKeyspaceEvents()), "set:t expire:t expire:t sadd:s del:t del:s ");
+
+    // Neither K nor E: the classes alone publish nothing
+    CHECK(store.setNotifyKeyspaceEvents("A"));
+    store.set("a", "3");
+    CHECK(store.takeKeyspaceEvents().empty());
+
+    pubSub.unregisterClient(subscriber);
+    CHECK_EQ(pubSub.keyspaceSubscriptions.load(), 0);
+    CHECK(store.setNotifyKeyspaceEvents("KEA"));
+    store.set("a", "4");
+    CHECK(store.takeKeyspaceEvents().empty());
+
+    RedisServer server(0);
+    ClientContext client;
+    CHECK_EQ(server.call("CONFIG SET notify-keyspace-events KEg$", client), "OK");
+    CHECK_EQ(server.call("CONFIG GET notify-keyspace-events", client), "notify-keyspace-events g$KE");
+    CHECK(server.call("CONFIG SET notify-keyspace-events Kq", client).rfind("ERROR:", 0) == 0);
+}
+
+// PSYNC continues from the backlog only while the requested offset is still inside the ring
+static void testReplicationBacklog() {
+    ReplicationBacklog backlog(16);
+    std::string out;
+    CHECK(backlog.readFrom(0, out));
+    CHECK_EQ(out, "");
+    CHECK(!backlog.readFrom(1, out));
+    
+    backlog.feed("SET a 1\n");
+    CHECK_EQ(backlog.offset(), 8);
+    CHECK_EQ(backlog.firstOffset(), 0);
+    CHECK(backlog.readFrom(0, out));
+    CHECK_EQ(out, "SET a 1\n");
+    CHECK(backlog.readFrom(4, out));
+    CHECK_EQ(out, "a 1\n");
+    
+    // Wraps around: 8 + 13 bytes fed into a 16 byte ring keeps the last 16
+    backlog.feed("INCR counter\n");
+    CHECK_EQ(backlog.offset(), 21);
+    CHECK_EQ(backlog.firstOffset(), 5);
+    CHECK(!backlog.readFrom(4, out));
+    CHECK(backlog.readFrom(5, out));
+    CHECK_EQ(out, " 1\nINCR counter\n");
+    CHECK(backlog.readFrom(21, out));
+    CHECK_EQ(out, "");
+    CHECK(!backlog.readFrom(22, out));
+    
+    // A feed larger than the ring keeps only its tail
+    backlog.feed(std::string(20, 'x') + "0123456789abcdef");
+    CHECK_EQ(backlog.offset(), 57);
+    CHECK(backlog.readFrom(41, out));
+    CHECK_EQ(out, "0123456789abcdef");
+    
+    // After a full resync the stream restarts at the primary's offset with no history
+    backlog.reset(1000);
+    CHECK_EQ(backlog.offset(), 1000);
+    CHECK_EQ(backlog.firstOffset(), 1000);
+    CHECK(!backlog.readFrom(999, out));
+    backlog.feed("DEL a\n");
+    CHECK(backlog.readFrom(1000, out));
+    CHECK_EQ(out, "DEL a\n");
+    
+    RedisServer server(0);
+    ClientContext client;
+    CHECK_EQ(server.call("CONFIG GET repl-output-buffer-limit", client), "repl-output-buffer-limit 268435456");
+    CHECK_EQ(server.call("CONFIG SET repl-output-buffer-limit 1mb", client), "OK");
+    CHECK_EQ(server.call("CONFIG GET repl-output-buffer-limit", client), "repl-output-buffer-limit 1048576");
+}
+
+// Slots match Redis CLUSTER KEYSLOT, with the first non-empty {...} as the hash tag
+static void testKeySlots() {
+    CHECK_EQ(keyHashSlot("foo"), 12182);
+    CHECK_EQ(keyHashSlot("bar"), 5061);
+    CHECK_EQ(keyHashSlot("hello"), 866);
+    CHECK_EQ(keyHashSlot("somekey"), 11058);
+    CHECK_EQ(keyHashSlot("{foo}.following"), 12182);
+    CHECK_EQ(keyHashSlot("{user1000}.following"), keyHashSlot("{user1000}.followers"));
+    CHECK_EQ(keyHashSlot("foo{bar}{zap}"), keyHashSlot("bar"));
+    CHECK(keyHashSlot("foo{}{bar}") != keyHashSlot("bar"));
+    CHECK_EQ(keyHashSlot("foo{{bar}}zap"), keyHashSlot("{bar"));
+    CHECK(keyHashSlot("foo{bar") != keyHashSlot("bar"));
+    CHECK(keyHashSlot("") >= 0 && keyHashSlot("") < CLUSTER_SLOTS);
+
+    // Destroying a started Cluster joins its bus threads, including readers blocked in recv
+    {
+        auto started = std::chrono::steady_clock::now();
+        SOCKET peer = INVALID_SOCKET;
+        {
+            Cluster bus(17391);
+            CHECK(bus.start([](const std::string&, const std::string&) {}));
+            peer = connectTo("127.0.0.1", 17391 + CLUSTER_BUS_PORT_OFFSET);
+            CHECK(peer != INVALID_SOCKET);
+            CHECK(sendAll(peer, "NODE x 127.0.0.1 1\n"));
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        char byte;
+        CHECK(peer == INVALID_SOCKET || recv(peer, &byte, 1, 0) <= 0);     // our link was shut down
+        if (peer != INVALID_SOCKET) closesocket(peer);
+        CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(2));
+    }
+
+    // MIGRATE keeps the key when the transfer fails, and never targets itself
+    RedisServer server(0);
+    ClientContext client;
+    CHECK_EQ(server.call("MIGRATE 127.0.0.1 0 k", client), "ERROR: MIGRATE target is this server");
+    CHECK_EQ(server.call("MIGRATE 127.0.0.1 1 missing", client), "NOKEY");
+    CHECK_EQ(server.call("SET k v", client), "OK");
+    CHECK(server.call("MIGRATE 127.0.0.1 1 k", client).rfind("ERROR: IOERR", 0) == 0);
+    CHECK_EQ(server.call("GET k", client), "v");
+}
+
+int main() {
+    testTransactions();
+    testHistogram();
+    testCommandStats();
+    testConfig();
+    testEviction();
+    testLazyFree();
+    testIntegers();
+    testTracking();
+    testKeyspaceEvents();
+    testReplicationBacklog();
+    testKeySlots();
+
+    std::cout << checks - failures << "/" << checks << " checks passed" << std::endl;
+    return failures ? 1 : 0;
+}